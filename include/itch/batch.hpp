@@ -0,0 +1,365 @@
+#ifndef TV_ITCH50_CPP_BATCH_HPP
+#define TV_ITCH50_CPP_BATCH_HPP
+
+#include "itch/parser.hpp"
+#include "itch/spec/messages.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace itch {
+
+// A run of messages of one type, handed to batch handler methods. It only holds the message
+// pointers; views are made on access, so iterating a Batch costs no more than a loop over
+// the pointers:
+//
+//     void onAddOrderBatch( const itch::Batch<itch::spec::view::AddOrderView> b ) {
+//         for ( const auto v : b ) total += v.shares();
+//     }
+template <class View>
+class Batch {
+
+public:
+	class iterator {
+
+	public:
+		explicit iterator(const std::uint8_t* const* p) noexcept : ptr(p) {/*no-op*/}
+
+		View operator*() const noexcept { return View{*ptr}; }
+		iterator& operator++() noexcept { ++ptr; return *this; }
+		bool operator==(const iterator& other) const noexcept = default;
+
+	private:
+		const std::uint8_t* const* ptr;
+
+	}; // class iterator
+
+	explicit Batch(std::span<const std::uint8_t* const> m) noexcept : msgs(m) {/*no-op*/}
+
+	[[nodiscard]] std::size_t size() const noexcept { return msgs.size(); }
+	[[nodiscard]] bool empty() const noexcept { return msgs.empty(); }
+	[[nodiscard]] View operator[](const std::size_t i) const noexcept { return View{msgs[i]}; }
+
+	[[nodiscard]] iterator begin() const noexcept { return iterator(msgs.data()); }
+	[[nodiscard]] iterator end() const noexcept { return iterator(msgs.data() + msgs.size()); }
+
+private:
+	std::span<const std::uint8_t* const> msgs;
+
+}; // class Batch
+
+namespace detail {
+
+// Whether Handler has a batch method for the given message type, e.g. onAddOrderBatch.
+template <class Handler>
+constexpr bool has_batch_method(const std::uint8_t type) noexcept {
+	using namespace spec::view;
+
+	switch (type) {
+		case 'S': return requires (Handler h, Batch<SystemEventView> b) {h.onSystemEventBatch(b);};
+		case 'R': return requires (Handler h, Batch<StockDirectoryView> b) {h.onStockDirectoryBatch(b);};
+		case 'H': return requires (Handler h, Batch<StockTradingActionView> b) {h.onStockTradingActionBatch(b);};
+		case 'Y': return requires (Handler h, Batch<RegSHORestrictionView> b) {h.onRegSHORestrictionBatch(b);};
+		case 'L': return requires (Handler h, Batch<MarketParticipantPositionView> b) {h.onMarketParticipantPositionBatch(b);};
+		case 'V': return requires (Handler h, Batch<MWCBDeclineLevelView> b) {h.onMWCBDeclineLevelBatch(b);};
+		case 'W': return requires (Handler h, Batch<MWCBStatusView> b) {h.onMWCBStatusBatch(b);};
+		case 'K': return requires (Handler h, Batch<IPOQuotingPeriodUpdateView> b) {h.onIPOQuotingPeriodUpdateBatch(b);};
+		case 'J': return requires (Handler h, Batch<LULDAuctionCollarView> b) {h.onLULDAuctionCollarBatch(b);};
+		case 'h': return requires (Handler h, Batch<OperationalHaltView> b) {h.onOperationalHaltBatch(b);};
+		case 'A': return requires (Handler h, Batch<AddOrderView> b) {h.onAddOrderBatch(b);};
+		case 'F': return requires (Handler h, Batch<AddOrderWithMPIDView> b) {h.onAddOrderWithMPIDBatch(b);};
+		case 'E': return requires (Handler h, Batch<ExecuteOrderView> b) {h.onExecuteOrderBatch(b);};
+		case 'C': return requires (Handler h, Batch<ExecuteOrderWithPriceView> b) {h.onExecuteOrderWithPriceBatch(b);};
+		case 'X': return requires (Handler h, Batch<CancelOrderView> b) {h.onCancelOrderBatch(b);};
+		case 'D': return requires (Handler h, Batch<DeleteOrderView> b) {h.onDeleteOrderBatch(b);};
+		case 'U': return requires (Handler h, Batch<ReplaceOrderView> b) {h.onReplaceOrderBatch(b);};
+		case 'P': return requires (Handler h, Batch<NonCrossTradeView> b) {h.onNonCrossTradeBatch(b);};
+		case 'Q': return requires (Handler h, Batch<CrossTradeView> b) {h.onCrossTradeBatch(b);};
+		case 'B': return requires (Handler h, Batch<BrokenTradeView> b) {h.onBrokenTradeBatch(b);};
+		case 'I': return requires (Handler h, Batch<NetOrderImbalanceView> b) {h.onNetOrderImbalanceBatch(b);};
+		case 'N': return requires (Handler h, Batch<RetailPriceImprovementView> b) {h.onRetailPriceImprovementBatch(b);};
+		case 'O': return requires (Handler h, Batch<DLCRPriceDiscoveryView> b) {h.onDLCRPriceDiscoveryBatch(b);};
+		default: return false;
+	}
+}
+
+template <class Handler>
+inline constexpr std::array<bool, 256> HAS_BATCH = [] {
+	std::array<bool, 256> has{};
+	for (std::size_t t = 0; t < 256; ++t) {
+		has[t] = has_batch_method<Handler>(static_cast<std::uint8_t>(t));
+	}
+	return has;
+}();
+
+template <class Handler>
+inline constexpr std::size_t BATCHED_COUNT = [] {
+	std::size_t n = 0;
+	for (const bool b : HAS_BATCH<Handler>) {
+		n += b;
+	}
+	return n;
+}();
+
+// The type bytes Handler has batch methods for, so the grouping loops only visit those.
+template <class Handler>
+inline constexpr auto BATCHED_TYPES = [] {
+	std::array<std::uint8_t, BATCHED_COUNT<Handler>> types{};
+	std::size_t k = 0;
+	for (std::size_t t = 0; t < 256; ++t) {
+		if (HAS_BATCH<Handler>[t]) {
+			types[k++] = static_cast<std::uint8_t>(t);
+		}
+	}
+	return types;
+}();
+
+// Calls the batch method for a run of messages that all have the given type.
+template <class Handler>
+void dispatch_group(
+	Handler& handler,
+	const std::uint8_t type,
+	const std::span<const std::uint8_t* const> group
+) noexcept {
+	using namespace spec::view;
+
+	switch (type) {
+		case 'S': {
+			using msgV = SystemEventView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onSystemEventBatch(b);}) {
+				handler.onSystemEventBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'R': {
+			using msgV = StockDirectoryView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onStockDirectoryBatch(b);}) {
+				handler.onStockDirectoryBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'H': {
+			using msgV = StockTradingActionView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onStockTradingActionBatch(b);}) {
+				handler.onStockTradingActionBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'Y': {
+			using msgV = RegSHORestrictionView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onRegSHORestrictionBatch(b);}) {
+				handler.onRegSHORestrictionBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'L': {
+			using msgV = MarketParticipantPositionView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onMarketParticipantPositionBatch(b);}) {
+				handler.onMarketParticipantPositionBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'V': {
+			using msgV = MWCBDeclineLevelView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onMWCBDeclineLevelBatch(b);}) {
+				handler.onMWCBDeclineLevelBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'W': {
+			using msgV = MWCBStatusView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onMWCBStatusBatch(b);}) {
+				handler.onMWCBStatusBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'K': {
+			using msgV = IPOQuotingPeriodUpdateView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onIPOQuotingPeriodUpdateBatch(b);}) {
+				handler.onIPOQuotingPeriodUpdateBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'J': {
+			using msgV = LULDAuctionCollarView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onLULDAuctionCollarBatch(b);}) {
+				handler.onLULDAuctionCollarBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'h': {
+			using msgV = OperationalHaltView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onOperationalHaltBatch(b);}) {
+				handler.onOperationalHaltBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'A': {
+			using msgV = AddOrderView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onAddOrderBatch(b);}) {
+				handler.onAddOrderBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'F': {
+			using msgV = AddOrderWithMPIDView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onAddOrderWithMPIDBatch(b);}) {
+				handler.onAddOrderWithMPIDBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'E': {
+			using msgV = ExecuteOrderView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onExecuteOrderBatch(b);}) {
+				handler.onExecuteOrderBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'C': {
+			using msgV = ExecuteOrderWithPriceView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onExecuteOrderWithPriceBatch(b);}) {
+				handler.onExecuteOrderWithPriceBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'X': {
+			using msgV = CancelOrderView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onCancelOrderBatch(b);}) {
+				handler.onCancelOrderBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'D': {
+			using msgV = DeleteOrderView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onDeleteOrderBatch(b);}) {
+				handler.onDeleteOrderBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'U': {
+			using msgV = ReplaceOrderView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onReplaceOrderBatch(b);}) {
+				handler.onReplaceOrderBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'P': {
+			using msgV = NonCrossTradeView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onNonCrossTradeBatch(b);}) {
+				handler.onNonCrossTradeBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'Q': {
+			using msgV = CrossTradeView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onCrossTradeBatch(b);}) {
+				handler.onCrossTradeBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'B': {
+			using msgV = BrokenTradeView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onBrokenTradeBatch(b);}) {
+				handler.onBrokenTradeBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'I': {
+			using msgV = NetOrderImbalanceView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onNetOrderImbalanceBatch(b);}) {
+				handler.onNetOrderImbalanceBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'N': {
+			using msgV = RetailPriceImprovementView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onRetailPriceImprovementBatch(b);}) {
+				handler.onRetailPriceImprovementBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+		case 'O': {
+			using msgV = DLCRPriceDiscoveryView;
+			if constexpr (requires (Handler h, Batch<msgV> b) {h.onDLCRPriceDiscoveryBatch(b);}) {
+				handler.onDLCRPriceDiscoveryBatch( Batch<msgV>{group} );
+			}
+			break;
+		}
+	}
+}
+
+} // namespace detail
+
+// Largest number of messages partitioned at once by dispatchBatch(). Bigger inputs are split.
+inline constexpr std::size_t MAX_BATCH = 256;
+
+// Dispatches a batch of messages (pointers at their type byte, as filled by
+// Parser::nextBatch). Types for which the Handler has a batch method (onXyzBatch, taking a
+// Batch<XyzView>) are grouped and each group is passed in one call, so a hot handler runs a
+// tight loop over messages of one type instead of going through the switch every time.
+// Every other message is passed to its per-message method, in order, during the grouping
+// pass; the groups follow after.
+//
+// Note: grouping changes the order of messages of different types within a batch. Messages
+// of one type stay in order. Handlers that depend on the order across types (e.g. an add
+// and then an execute of the same order) should not use batch methods for those types.
+// A Handler with no batch methods at all gets exactly what dispatch() would give it.
+template <class Handler>
+void dispatchBatch(Handler& handler, std::span<const std::uint8_t* const> msgs) noexcept {
+	if constexpr (detail::BATCHED_COUNT<Handler> == 0) {
+		for (const std::uint8_t* const msg : msgs) {
+			dispatch(handler, msg);
+		}
+	} else {
+		constexpr auto& has_batch = detail::HAS_BATCH<Handler>;
+
+		while (!msgs.empty()) {
+			const std::size_t n = msgs.size() < MAX_BATCH ? msgs.size() : MAX_BATCH;
+
+			// Counting sort by type byte. Non-batched types are dispatched on the way.
+			std::array<std::uint16_t, 256> counts{};
+			for (std::size_t i = 0; i < n; ++i) {
+				const std::uint8_t type = msgs[i][0];
+				if (has_batch[type]) {
+					++counts[type];
+				} else {
+					dispatch(handler, msgs[i]);
+				}
+			}
+
+			std::array<std::uint16_t, 256> starts{};
+			std::uint16_t total = 0;
+			for (const std::uint8_t t : detail::BATCHED_TYPES<Handler>) {
+				starts[t] = total;
+				total = static_cast<std::uint16_t>(total + counts[t]);
+			}
+
+			std::array<const std::uint8_t*, MAX_BATCH> sorted;
+			std::array<std::uint16_t, 256> fill = starts;
+			for (std::size_t i = 0; i < n; ++i) {
+				const std::uint8_t type = msgs[i][0];
+				if (has_batch[type]) {
+					sorted[fill[type]++] = msgs[i];
+				}
+			}
+
+			for (const std::uint8_t t : detail::BATCHED_TYPES<Handler>) {
+				if (counts[t] != 0) {
+					detail::dispatch_group(
+						handler,
+						t,
+						std::span<const std::uint8_t* const>(sorted.data() + starts[t], counts[t])
+					);
+				}
+			}
+
+			msgs = msgs.subspan(n);
+		}
+	}
+}
+
+} // namespace itch
+
+#endif // TV_ITCH50_CPP_BATCH_HPP
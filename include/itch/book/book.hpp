@@ -0,0 +1,144 @@
+#ifndef TV_ITCH50_CPP_BOOK_HPP
+#define TV_ITCH50_CPP_BOOK_HPP
+
+#include "itch/spec/messages.hpp"
+#include "itch/spec/order_store.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace itch::book {
+
+// Null index for pools and intrusive lists.
+inline constexpr std::uint32_t NIL = 0xFFFFFFFF;
+
+struct Order {
+	std::uint64_t order_id;
+	std::uint32_t shares;   // Open shares, after executions and cancellations.
+	std::uint32_t price;    // Actual price = price / 10^4
+	std::uint32_t level;    // Index of its price level.
+	std::uint32_t prev;     // Previous (older) order at the same level, or NIL.
+	std::uint32_t next;     // Next (newer) order at the same level, or NIL.
+	std::uint16_t stock_locate;
+	std::uint8_t  side;     // 'B' or 'S'
+};
+
+struct Level {
+	std::uint64_t shares;   // Sum of open shares of all orders at this price.
+	std::uint32_t price;    // Actual price = price / 10^4
+	std::uint32_t order_count;
+	std::uint32_t head;     // Oldest order, first in the queue.
+	std::uint32_t tail;     // Newest order.
+};
+
+// Index-addressed object pool. Released slots are reused before the pool grows, so once the
+// pool reaches the high-water mark of live objects, alloc() and release() never allocate.
+template <typename T>
+class Pool {
+
+public:
+	void reserve(const std::size_t n) {
+		slots.reserve(n);
+		free_slots.reserve(n);
+	}
+
+	std::uint32_t alloc() {
+		if (!free_slots.empty()) {
+			const std::uint32_t i = free_slots.back();
+			free_slots.pop_back();
+			return i;
+		}
+		slots.emplace_back();
+		return static_cast<std::uint32_t>(slots.size() - 1);
+	}
+
+	void release(const std::uint32_t i) { free_slots.push_back(i); }
+
+	[[nodiscard]] T& operator[](const std::uint32_t i) noexcept { return slots[i]; }
+	[[nodiscard]] const T& operator[](const std::uint32_t i) const noexcept { return slots[i]; }
+
+	[[nodiscard]] std::size_t live() const noexcept { return slots.size() - free_slots.size(); }
+
+private:
+	std::vector<T> slots;
+	std::vector<std::uint32_t> free_slots;
+
+}; // class Pool
+
+// The price levels of one instrument. Level indices are sorted from worst to best price, so
+// the best level is at the back and most insertions and removals (which happen near the
+// top of the book) shift few elements.
+class OrderBook {
+
+public:
+	[[nodiscard]] const std::vector<std::uint32_t>& bids() const noexcept { return bid_levels; }
+	[[nodiscard]] const std::vector<std::uint32_t>& asks() const noexcept { return ask_levels; }
+
+private:
+	friend class OrderBookMaster;
+
+	std::vector<std::uint32_t> bid_levels; // Ascending price.
+	std::vector<std::uint32_t> ask_levels; // Descending price.
+
+}; // class OrderBook
+
+// Full-depth (market-by-order) books for every stock_locate, built from the order messages
+// of the feed. Pass it to Parser as the handler, or call it from your own handler. Orders
+// and levels live in pools shared by all books, and order ids are looked up through a
+// spec::OrderStore, so the steady state allocates nothing.
+// Messages for orders the master has never seen (e.g. when starting mid-day) are ignored, as
+// are adds (and replaces) to an order id that is already live.
+class OrderBookMaster {
+
+public:
+	explicit OrderBookMaster(std::size_t expected_orders = 1u << 20);
+
+	void onAddOrder(spec::view::AddOrderView v);
+	void onAddOrderWithMPID(spec::view::AddOrderWithMPIDView v);
+	void onExecuteOrder(spec::view::ExecuteOrderView v);
+	void onExecuteOrderWithPrice(spec::view::ExecuteOrderWithPriceView v);
+	void onCancelOrder(spec::view::CancelOrderView v);
+	void onDeleteOrder(spec::view::DeleteOrderView v);
+	void onReplaceOrder(spec::view::ReplaceOrderView v);
+
+	// An empty book is returned for locates that haven't been seen.
+	[[nodiscard]] const OrderBook& book(std::uint16_t stock_locate) const noexcept;
+
+	// Best level of a side, or nullptr if that side is empty.
+	[[nodiscard]] const Level* best_bid(std::uint16_t stock_locate) const noexcept;
+	[[nodiscard]] const Level* best_ask(std::uint16_t stock_locate) const noexcept;
+
+	// Order by order_id, or nullptr if it isn't live.
+	[[nodiscard]] const Order* find(std::uint64_t order_id) const noexcept;
+
+	// Indices as found in OrderBook, Level::head/tail and Order::prev/next/level.
+	[[nodiscard]] const Level& level(std::uint32_t i) const noexcept { return levels[i]; }
+	[[nodiscard]] const Order& order(std::uint32_t i) const noexcept { return orders[i]; }
+
+	[[nodiscard]] std::size_t live_orders() const noexcept { return orders.live(); }
+	[[nodiscard]] std::uint64_t unknown_order_messages() const noexcept { return unknown; }
+	[[nodiscard]] std::uint64_t duplicate_order_messages() const noexcept { return duplicate; }
+
+private:
+	std::vector<OrderBook> books; // Indexed by stock_locate.
+	Pool<Order> orders;
+	Pool<Level> levels;
+	spec::OrderStore<std::uint32_t> ids; // order_id -> order index.
+	std::uint64_t unknown = 0;
+	std::uint64_t duplicate = 0;
+
+	void add(std::uint64_t order_id, std::uint16_t stock_locate, std::uint8_t side,
+	         std::uint32_t price, std::uint32_t shares);
+	void reduce(std::uint64_t order_id, std::uint32_t shares);
+	void remove(std::uint32_t oi);
+
+	std::uint32_t find_or_add_level(std::vector<std::uint32_t>& side_levels, bool is_bid,
+	                                std::uint32_t price);
+	void remove_level(std::vector<std::uint32_t>& side_levels, bool is_bid, std::uint32_t li);
+
+}; // class OrderBookMaster
+
+} // namespace itch::book
+
+#endif // TV_ITCH50_CPP_BOOK_HPP
@@ -0,0 +1,238 @@
+#ifndef TV_ITCH50_CPP_CAPTURE_PARSER_HPP
+#define TV_ITCH50_CPP_CAPTURE_PARSER_HPP
+
+#include "itch/dispatch.hpp"
+#include "itch/mmap/mmap.hpp"
+#include "itch/mold/mold.hpp"
+#include "itch/pcap/pcap.hpp"
+#include "itch/util/util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace itch {
+
+struct CaptureOptions {
+	std::uint16_t port = 0;        // Only UDP datagrams to this port; 0 takes them all.
+	std::uint32_t group = 0;       // Only datagrams to this IPv4 address (host order); 0: any.
+	// Skip messages whose sequence number the line already passed, so packets the capture
+	// holds twice (repeated, or retransmitted on the same line) yield each message once. A
+	// gap shows as a jump in sequence().
+	bool dedupe = true;
+	mmap::MapOptions map;          // Any but a window.
+};
+
+struct CaptureStats {
+	std::uint64_t frames = 0;
+	std::uint64_t packets = 0;     // MoldUDP64 packets taken, heartbeats included.
+	std::uint64_t skipped = 0;     // Frames that weren't MoldUDP64, were filtered out, or were
+	                               // on another line.
+	std::uint64_t malformed = 0;   // MoldUDP64 packets cut short; the messages that fit are kept.
+};
+
+// Same interface as Parser, but over a pcap or pcapng capture of a MoldUDP64 feed: the
+// capture is mapped, and each message is handed over in place, with the time it was captured
+// (timestamp()) and its sequence number (sequence()). It follows one MoldUDP64 session at a
+// time, moving on to the next after its end-of-session packet, and ignores other traffic.
+//
+// It also follows one line: the destination address and port of the first MoldUDP64 packet
+// it takes (pick one with CaptureOptions). A capture of both the A and B lines is better merged
+// by a mold::Arbiter (see mold::run() in itch/mold/arbiter.hpp), which fills one line's losses
+// from the other; here, what the line lost is a gap.
+template <class Handler, class DispatchPolicy = policy::Default>
+class CaptureParser {
+
+private:
+	// Everything but the walk through the current packet. It's on the heap and only reached
+	// through a reference, so the parser itself never escapes to the out-of-line reader, and
+	// next() can keep the walk in registers as Parser does.
+	struct Source {
+		pcap::Capture capture;
+		const CaptureOptions options;
+		CaptureStats stats;
+		pcap::Frame frame;
+		pcap::Datagram datagram;
+		std::array<char, mold::SESSION_SIZE> session{};
+		bool has_session = false;
+		bool is_session_ended = false;
+		std::uint64_t expected = 1;     // Next new sequence number of the session.
+		bool has_line = false;
+		std::uint32_t line_address = 0; // Destination of the line followed.
+		std::uint16_t line_port = 0;
+
+		Source(const std::string& filepath, const CaptureOptions& o)
+		: capture(filepath, o.map)
+		, options(o)
+		{/*no-op*/}
+	};
+
+	// Where the walk through a packet starts.
+	struct Start {
+		const std::uint8_t* ptr = nullptr; // First new message, at its length field.
+		const std::uint8_t* end = nullptr;
+		std::uint64_t sequence = 0;
+		std::uint16_t count = 0;           // New messages; 0 at the end of the capture.
+	};
+
+	Handler& handler;
+	const std::unique_ptr<Source> source;
+	const std::uint8_t* ptr = nullptr;  // The current message, at its type byte.
+	const std::uint8_t* end = nullptr;  // End of the current packet.
+	std::uint16_t msg_len = 0;
+	std::uint16_t left = 0;             // Messages in the packet from the current one on.
+	std::uint64_t sequence_ = 0;
+	bool is_eof = false;
+
+	// Whether a whole message block starts at p.
+	[[nodiscard]] static bool fits(const std::uint8_t* const p, const std::uint8_t* const end) noexcept {
+		return end - p >= 2 && end - p - 2 >= util::read_be<std::uint16_t>(p);
+	}
+
+	// Finds the first new message of the next MoldUDP64 packet that has one.
+	[[gnu::noinline]] static Start nextPacket(Source& s) {
+		while (s.capture.next(s.frame)) {
+			++s.stats.frames;
+			const pcap::Datagram& d = s.datagram;
+			if (!pcap::parse_udp(s.frame, s.datagram) ||
+			    (s.options.port != 0 && d.destination_port != s.options.port) ||
+			    (s.options.group != 0 && d.destination != s.options.group) ||
+			    d.payload.size() < mold::HEADER_SIZE) {
+				++s.stats.skipped;
+				continue;
+			}
+			// Only one line, since the sequence numbers of another one can't tell its copy of
+			// a packet this one lost from a repeat.
+			if (s.has_line && (d.destination != s.line_address || d.destination_port != s.line_port)) {
+				++s.stats.skipped;
+				continue;
+			}
+
+			const mold::PacketView packet(d.payload.data());
+			const std::string_view session = packet.session();
+			const std::string_view current(s.session.data(), mold::SESSION_SIZE);
+			if (!s.has_session || (s.is_session_ended && session != current)) {
+				std::copy(session.begin(), session.end(), s.session.begin());
+				s.has_session = true;
+				s.has_line = true;
+				s.line_address = d.destination;
+				s.line_port = d.destination_port;
+				s.is_session_ended = false;
+				s.expected = 1;
+			} else if (session != current) {
+				++s.stats.skipped;
+				continue;
+			}
+			++s.stats.packets;
+
+			const std::uint64_t first = packet.sequence();
+			const std::uint16_t count = packet.count();
+			if (count == mold::END_OF_SESSION) {
+				s.is_session_ended = true;
+				continue;
+			}
+			if (count == 0) continue;
+
+			// The copy from the other line is dropped here, before any of it is read.
+			const std::uint64_t skip = s.options.dedupe && first < s.expected
+				? std::min<std::uint64_t>(s.expected - first, count) : 0;
+			if (skip == count) continue;
+
+			// The framing is checked as the messages are walked, rather than in a pass of its
+			// own, which would double the cost of the walk.
+			const std::uint8_t* const packet_end = d.payload.data() + d.payload.size();
+			const std::uint8_t* p = packet.messages();
+			std::uint64_t i = 0;
+			for (; i <= skip && fits(p, packet_end); ++i) {
+				if (i < skip) p += 2 + util::read_be<std::uint16_t>(p);
+			}
+			if (i <= skip) {
+				++s.stats.malformed;
+				continue;
+			}
+
+			s.expected = std::max(s.expected, first + count);
+			return {p, packet_end, first + skip, static_cast<std::uint16_t>(count - skip)};
+		}
+		return {};
+	}
+
+public:
+	explicit CaptureParser(const std::string& filepath, Handler& h, const CaptureOptions& options = {})
+	: handler(h)
+	, source(new Source(filepath, options))
+	{/*no-op*/}
+
+	CaptureParser(const CaptureParser&) = delete;
+	CaptureParser& operator=(const CaptureParser&) = delete;
+	CaptureParser(const CaptureParser&&) = delete;
+	CaptureParser& operator=(const CaptureParser&&) = delete;
+
+	// Turns true once next() has returned false.
+	[[nodiscard]] bool eof() const noexcept { return is_eof; }
+
+	bool next() {
+		if (left > 1) {
+			const std::uint8_t* const p = ptr + msg_len;
+			if (fits(p, end)) {
+				msg_len = util::read_be<std::uint16_t>(p);
+				ptr = p + 2;
+				++sequence_;
+				--left;
+				return true;
+			}
+
+			// Cut short: the rest of the packet is dropped, and can still come from the other
+			// line.
+			++source->stats.malformed;
+			source->expected = sequence_ + 1;
+		}
+
+		left = 0;
+		if (is_eof) return false;
+
+		const Start start = nextPacket(*source);
+		if (start.count == 0) {
+			is_eof = true;
+			return false;
+		}
+		msg_len = util::read_be<std::uint16_t>(start.ptr);
+		ptr = start.ptr + 2;
+		end = start.end;
+		sequence_ = start.sequence;
+		left = start.count;
+		return true;
+	}
+
+	// Pointer to the current message, at its type byte. Valid for the life of the parser.
+	[[nodiscard]] const std::uint8_t* message() const noexcept { return ptr; }
+
+	// Capture time of the packet holding the current message, in ns since the Unix epoch.
+	[[nodiscard]] std::uint64_t timestamp() const noexcept { return source->frame.timestamp; }
+
+	// MoldUDP64 sequence number of the current message.
+	[[nodiscard]] std::uint64_t sequence() const noexcept { return sequence_; }
+
+	// Empty until the first packet.
+	[[nodiscard]] std::string_view session() const noexcept {
+		return {source->session.data(), source->has_session ? mold::SESSION_SIZE : 0};
+	}
+
+	// The UDP datagram holding the current message.
+	[[nodiscard]] const pcap::Datagram& udp() const noexcept { return source->datagram; }
+
+	[[nodiscard]] const CaptureStats& stats() const noexcept { return source->stats; }
+
+	void callHandler() const noexcept {
+		policy::dispatch<DispatchPolicy>(handler, ptr, msg_len);
+	}
+
+}; // class CaptureParser
+
+} // namespace itch
+
+#endif // TV_ITCH50_CPP_CAPTURE_PARSER_HPP
@@ -0,0 +1,376 @@
+#ifndef TV_ITCH50_CPP_DISPATCH_HPP
+#define TV_ITCH50_CPP_DISPATCH_HPP
+
+#include "itch/instrument/instrument.hpp"
+#include "itch/spec/messages.hpp"
+#include "itch/util/util.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace itch {
+
+// Calls the Handler method for a message whose type is known at compile time, or does
+// nothing if the Handler does not define it. msg must point to the message type byte.
+template <std::uint8_t Type, class Handler>
+void dispatchAs(Handler& handler, const std::uint8_t* const msg) noexcept {
+	using namespace spec::view;
+
+	if constexpr (Type == 'S') {
+		using msgV = SystemEventView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onSystemEvent(v);}) {
+			handler.onSystemEvent( msgV{msg} );
+		}
+	} else if constexpr (Type == 'R') {
+		using msgV = StockDirectoryView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onStockDirectory(v);}) {
+			handler.onStockDirectory( msgV{msg} );
+		}
+	} else if constexpr (Type == 'H') {
+		using msgV = StockTradingActionView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onStockTradingAction(v);}) {
+			handler.onStockTradingAction( msgV{msg} );
+		}
+	} else if constexpr (Type == 'Y') {
+		using msgV = RegSHORestrictionView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onRegSHORestriction(v);}) {
+			handler.onRegSHORestriction( msgV{msg} );
+		}
+	} else if constexpr (Type == 'L') {
+		using msgV = MarketParticipantPositionView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onMarketParticipantPosition(v);}) {
+			handler.onMarketParticipantPosition( msgV{msg} );
+		}
+	} else if constexpr (Type == 'V') {
+		using msgV = MWCBDeclineLevelView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onMWCBDeclineLevel(v);}) {
+			handler.onMWCBDeclineLevel( msgV{msg} );
+		}
+	} else if constexpr (Type == 'W') {
+		using msgV = MWCBStatusView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onMWCBStatus(v);}) {
+			handler.onMWCBStatus( msgV{msg} );
+		}
+	} else if constexpr (Type == 'K') {
+		using msgV = IPOQuotingPeriodUpdateView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onIPOQuotingPeriodUpdate(v);}) {
+			handler.onIPOQuotingPeriodUpdate( msgV{msg} );
+		}
+	} else if constexpr (Type == 'J') {
+		using msgV = LULDAuctionCollarView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onLULDAuctionCollar(v);}) {
+			handler.onLULDAuctionCollar( msgV{msg} );
+		}
+	} else if constexpr (Type == 'h') {
+		using msgV = OperationalHaltView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onOperationalHalt(v);}) {
+			handler.onOperationalHalt( msgV{msg} );
+		}
+	} else if constexpr (Type == 'A') {
+		using msgV = AddOrderView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onAddOrder(v);}) {
+			handler.onAddOrder( msgV{msg} );
+		}
+	} else if constexpr (Type == 'F') {
+		using msgV = AddOrderWithMPIDView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onAddOrderWithMPID(v);}) {
+			handler.onAddOrderWithMPID( msgV{msg} );
+		}
+	} else if constexpr (Type == 'E') {
+		using msgV = ExecuteOrderView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onExecuteOrder(v);}) {
+			handler.onExecuteOrder( msgV{msg} );
+		}
+	} else if constexpr (Type == 'C') {
+		using msgV = ExecuteOrderWithPriceView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onExecuteOrderWithPrice(v);}) {
+			handler.onExecuteOrderWithPrice( msgV{msg} );
+		}
+	} else if constexpr (Type == 'X') {
+		using msgV = CancelOrderView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onCancelOrder(v);}) {
+			handler.onCancelOrder( msgV{msg} );
+		}
+	} else if constexpr (Type == 'D') {
+		using msgV = DeleteOrderView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onDeleteOrder(v);}) {
+			handler.onDeleteOrder( msgV{msg} );
+		}
+	} else if constexpr (Type == 'U') {
+		using msgV = ReplaceOrderView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onReplaceOrder(v);}) {
+			handler.onReplaceOrder( msgV{msg} );
+		}
+	} else if constexpr (Type == 'P') {
+		using msgV = NonCrossTradeView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onNonCrossTrade(v);}) {
+			handler.onNonCrossTrade( msgV{msg} );
+		}
+	} else if constexpr (Type == 'Q') {
+		using msgV = CrossTradeView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onCrossTrade(v);}) {
+			handler.onCrossTrade( msgV{msg} );
+		}
+	} else if constexpr (Type == 'B') {
+		using msgV = BrokenTradeView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onBrokenTrade(v);}) {
+			handler.onBrokenTrade( msgV{msg} );
+		}
+	} else if constexpr (Type == 'I') {
+		using msgV = NetOrderImbalanceView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onNetOrderImbalance(v);}) {
+			handler.onNetOrderImbalance( msgV{msg} );
+		}
+	} else if constexpr (Type == 'N') {
+		using msgV = RetailPriceImprovementView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onRetailPriceImprovement(v);}) {
+			handler.onRetailPriceImprovement( msgV{msg} );
+		}
+	} else if constexpr (Type == 'O') {
+		using msgV = DLCRPriceDiscoveryView;
+		if constexpr (requires (Handler h, msgV v)
+		              {h.onDLCRPriceDiscovery(v);}) {
+			handler.onDLCRPriceDiscovery( msgV{msg} );
+		}
+	}
+}
+
+// Calls the Handler method matching the message type, or does nothing if the Handler
+// does not define it. msg must point to the message type byte (after the length field).
+template <class Handler>
+void dispatch(Handler& handler, const std::uint8_t* const msg) noexcept {
+	const auto curr_msg_type = util::read_be<std::uint8_t>(msg);
+	switch (curr_msg_type) {
+		case 'S': dispatchAs<'S'>(handler, msg); break;
+		case 'R': dispatchAs<'R'>(handler, msg); break;
+		case 'H': dispatchAs<'H'>(handler, msg); break;
+		case 'Y': dispatchAs<'Y'>(handler, msg); break;
+		case 'L': dispatchAs<'L'>(handler, msg); break;
+		case 'V': dispatchAs<'V'>(handler, msg); break;
+		case 'W': dispatchAs<'W'>(handler, msg); break;
+		case 'K': dispatchAs<'K'>(handler, msg); break;
+		case 'J': dispatchAs<'J'>(handler, msg); break;
+		case 'h': dispatchAs<'h'>(handler, msg); break;
+		case 'A': dispatchAs<'A'>(handler, msg); break;
+		case 'F': dispatchAs<'F'>(handler, msg); break;
+		case 'E': dispatchAs<'E'>(handler, msg); break;
+		case 'C': dispatchAs<'C'>(handler, msg); break;
+		case 'X': dispatchAs<'X'>(handler, msg); break;
+		case 'D': dispatchAs<'D'>(handler, msg); break;
+		case 'U': dispatchAs<'U'>(handler, msg); break;
+		case 'P': dispatchAs<'P'>(handler, msg); break;
+		case 'Q': dispatchAs<'Q'>(handler, msg); break;
+		case 'B': dispatchAs<'B'>(handler, msg); break;
+		case 'I': dispatchAs<'I'>(handler, msg); break;
+		case 'N': dispatchAs<'N'>(handler, msg); break;
+		case 'O': dispatchAs<'O'>(handler, msg); break;
+	}
+}
+
+// Dispatch policies for Parser. Each one is a different way for the compiler to get from the
+// type byte to the handler method; which is fastest depends on the compiler, the CPU and the
+// message mix, so measure (see src/ignored/benchmark.txt). They all call the same methods.
+namespace policy {
+
+// The switch in dispatch(). The compiler picks between a jump table and a compare tree.
+struct Switch {
+	template <class Handler>
+	static void dispatch(Handler& handler, const std::uint8_t* const msg) noexcept {
+		itch::dispatch(handler, msg);
+	}
+};
+
+// A 256-entry table of function pointers indexed by the type byte, built at compile time.
+// Always an indirect call, even for types the handler doesn't define.
+struct Table {
+	template <class Handler>
+	using Fn = void (*)(Handler&, const std::uint8_t*) noexcept;
+
+	template <class Handler>
+	static void none(Handler&, const std::uint8_t*) noexcept {/*no-op*/}
+
+	template <class Handler>
+	static constexpr std::array<Fn<Handler>, 256> TABLE = [] {
+		std::array<Fn<Handler>, 256> t{};
+		t.fill(&none<Handler>);
+		t['S'] = &dispatchAs<'S', Handler>;
+		t['R'] = &dispatchAs<'R', Handler>;
+		t['H'] = &dispatchAs<'H', Handler>;
+		t['Y'] = &dispatchAs<'Y', Handler>;
+		t['L'] = &dispatchAs<'L', Handler>;
+		t['V'] = &dispatchAs<'V', Handler>;
+		t['W'] = &dispatchAs<'W', Handler>;
+		t['K'] = &dispatchAs<'K', Handler>;
+		t['J'] = &dispatchAs<'J', Handler>;
+		t['h'] = &dispatchAs<'h', Handler>;
+		t['A'] = &dispatchAs<'A', Handler>;
+		t['F'] = &dispatchAs<'F', Handler>;
+		t['E'] = &dispatchAs<'E', Handler>;
+		t['C'] = &dispatchAs<'C', Handler>;
+		t['X'] = &dispatchAs<'X', Handler>;
+		t['D'] = &dispatchAs<'D', Handler>;
+		t['U'] = &dispatchAs<'U', Handler>;
+		t['P'] = &dispatchAs<'P', Handler>;
+		t['Q'] = &dispatchAs<'Q', Handler>;
+		t['B'] = &dispatchAs<'B', Handler>;
+		t['I'] = &dispatchAs<'I', Handler>;
+		t['N'] = &dispatchAs<'N', Handler>;
+		t['O'] = &dispatchAs<'O', Handler>;
+		return t;
+	}();
+
+	template <class Handler>
+	static void dispatch(Handler& handler, const std::uint8_t* const msg) noexcept {
+		TABLE<Handler>[msg[0]](handler, msg);
+	}
+};
+
+// A jump through a table of label addresses ("computed goto"). This is a GCC/Clang extension,
+// the only one in this library, so it's opt-in; on other compilers it's the same as Switch.
+// -Wpedantic flags every label address, and this header is included whether it's used or not.
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+struct ComputedGoto {
+	template <class Handler>
+	static void dispatch(Handler& handler, const std::uint8_t* const msg) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+		static const void* const labels[256] = {
+			&&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0,
+			&&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0,
+			&&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0,
+			&&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0,
+			&&L_0, &&L_A, &&L_B, &&L_C, &&L_D, &&L_E, &&L_F, &&L_0, &&L_H, &&L_I, &&L_J, &&L_K, &&L_L, &&L_0, &&L_N, &&L_O,
+			&&L_P, &&L_Q, &&L_R, &&L_S, &&L_0, &&L_U, &&L_V, &&L_W, &&L_X, &&L_Y, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0,
+			&&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_h, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0,
+			&&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0,
+			&&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0,
+			&&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0,
+			&&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0,
+			&&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0,
+			&&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0,
+			&&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0,
+			&&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0,
+			&&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0, &&L_0,
+		};
+		goto *labels[msg[0]];
+
+	L_S: dispatchAs<'S'>(handler, msg); return;
+	L_R: dispatchAs<'R'>(handler, msg); return;
+	L_H: dispatchAs<'H'>(handler, msg); return;
+	L_Y: dispatchAs<'Y'>(handler, msg); return;
+	L_L: dispatchAs<'L'>(handler, msg); return;
+	L_V: dispatchAs<'V'>(handler, msg); return;
+	L_W: dispatchAs<'W'>(handler, msg); return;
+	L_K: dispatchAs<'K'>(handler, msg); return;
+	L_J: dispatchAs<'J'>(handler, msg); return;
+	L_h: dispatchAs<'h'>(handler, msg); return;
+	L_A: dispatchAs<'A'>(handler, msg); return;
+	L_F: dispatchAs<'F'>(handler, msg); return;
+	L_E: dispatchAs<'E'>(handler, msg); return;
+	L_C: dispatchAs<'C'>(handler, msg); return;
+	L_X: dispatchAs<'X'>(handler, msg); return;
+	L_D: dispatchAs<'D'>(handler, msg); return;
+	L_U: dispatchAs<'U'>(handler, msg); return;
+	L_P: dispatchAs<'P'>(handler, msg); return;
+	L_Q: dispatchAs<'Q'>(handler, msg); return;
+	L_B: dispatchAs<'B'>(handler, msg); return;
+	L_I: dispatchAs<'I'>(handler, msg); return;
+	L_N: dispatchAs<'N'>(handler, msg); return;
+	L_O: dispatchAs<'O'>(handler, msg); return;
+	L_0:
+		return;
+#else
+		itch::dispatch(handler, msg);
+#endif
+	}
+};
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// Compare-and-branch for the five most frequent types first (adds, deletes, replaces,
+// executions and cancellations, which make up the bulk of a day), then the switch for the
+// rest. Well predicted when the mix is dominated by a couple of types.
+struct HotFirst {
+	template <class Handler>
+	static void dispatch(Handler& handler, const std::uint8_t* const msg) noexcept {
+		const std::uint8_t type = msg[0];
+		if (type == 'A') {
+			dispatchAs<'A'>(handler, msg);
+		} else if (type == 'D') {
+			dispatchAs<'D'>(handler, msg);
+		} else if (type == 'U') {
+			dispatchAs<'U'>(handler, msg);
+		} else if (type == 'E') {
+			dispatchAs<'E'>(handler, msg);
+		} else if (type == 'X') {
+			dispatchAs<'X'>(handler, msg);
+		} else {
+			itch::dispatch(handler, msg);
+		}
+	}
+};
+
+// How the parsers call a policy: with the message's length field as well, for the policies
+// that take it. The others only get the message.
+template <class Policy, class Handler>
+void dispatch(Handler& handler, const std::uint8_t* const msg, const std::uint16_t length) noexcept {
+	if constexpr (requires { Policy::dispatch(handler, msg, length); }) {
+		Policy::dispatch(handler, msg, length);
+	} else {
+		Policy::dispatch(handler, msg);
+	}
+}
+
+// Inner, timed: counts each message, its bytes as framed and the ticks its handler call took
+// in the calling thread's instrument::stats(). Two clock reads per message; see
+// itch/instrument/instrument.hpp.
+template <class Inner = Switch>
+struct Instrumented {
+	template <class Handler>
+	static void dispatch(Handler& handler, const std::uint8_t* const msg, const std::uint16_t length) noexcept {
+		const std::uint64_t begin = instrument::now();
+		policy::dispatch<Inner>(handler, msg, length);
+		const std::uint64_t end = instrument::now();
+		instrument::stats().add(msg[0], 2 + std::uint64_t{length}, end - begin);
+	}
+};
+
+// The default of every parser: Switch, or Switch instrumented when built with
+// TV_ITCH50_CPP_INSTRUMENT. Without it, Default is Switch itself, so nothing is left behind.
+#ifdef TV_ITCH50_CPP_INSTRUMENT
+using Default = Instrumented<Switch>;
+#else
+using Default = Switch;
+#endif
+
+} // namespace policy
+
+} // namespace itch
+
+#endif // TV_ITCH50_CPP_DISPATCH_HPP
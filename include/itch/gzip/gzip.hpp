@@ -0,0 +1,110 @@
+#ifndef TV_ITCH50_CPP_GZIP_HPP
+#define TV_ITCH50_CPP_GZIP_HPP
+
+#ifndef TV_ITCH50_CPP_HAS_ZLIB
+#error "itch/gzip needs zlib, which CMake did not find when building tv_itch50_cpp"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace itch::gzip {
+
+// 32 KB, the most a deflate block can refer back to.
+inline constexpr std::size_t WINDOW_SIZE = 32768;
+
+// A place where inflating can resume in the middle of a .gz file: the start of a deflate
+// block, along with the window of output before it.
+struct AccessPoint {
+	std::uint64_t in = 0;        // Offset in the .gz file of the first full byte of the block.
+	std::uint64_t out = 0;       // Offset in the uncompressed data.
+	std::uint64_t first_msg = 0; // First message boundary at or after out.
+	std::uint8_t bits = 0;       // Bits of the byte before in that belong to the block (0-7).
+	std::vector<std::uint8_t> window; // The WINDOW_SIZE bytes of output before out.
+};
+
+// Access points every span bytes (or so) of uncompressed data, as in zlib's zran example, so
+// that a .gz file can be decompressed from several places at once. Building it takes one full
+// inflate pass, so like MessageIndex it's cached in a sidecar, "<filepath>.gzidx". Only
+// single-member files (which is what Nasdaq publishes) can be indexed.
+class GzipIndex {
+
+public:
+	static constexpr std::uint64_t DEFAULT_SPAN = 16u << 20;
+
+	GzipIndex() = default;
+
+	// Inflates the whole file once. Also walks the messages, to find each point's first_msg,
+	// and throws if the last one is truncated.
+	static GzipIndex build(const std::string& filepath, std::uint64_t span = DEFAULT_SPAN);
+
+	// Loads the sidecar of the given file. Throws if it's missing, corrupt, or if it was built
+	// for a file of a different size or modification time.
+	static GzipIndex load(const std::string& filepath);
+
+	// Loads the sidecar if it's usable, otherwise builds the index and tries to save it.
+	// Failing to write the sidecar is not an error.
+	static GzipIndex load_or_build(const std::string& filepath, std::uint64_t span = DEFAULT_SPAN);
+
+	// Replaces the sidecar as a whole: a crash leaves either the old one or the new one.
+	void save(const std::string& filepath) const;
+
+	// The sidecar path used for the given input file: "<filepath>.gzidx"
+	[[nodiscard]] static std::string sidecar_path(const std::string& filepath);
+
+	[[nodiscard]] const std::vector<AccessPoint>& points() const noexcept { return points_; }
+	[[nodiscard]] std::uint64_t file_size() const noexcept { return file_size_; }
+	[[nodiscard]] std::uint64_t size() const noexcept { return size_; } // Uncompressed.
+	[[nodiscard]] std::uint64_t message_count() const noexcept { return message_count_; }
+	[[nodiscard]] std::uint64_t span() const noexcept { return span_; }
+
+private:
+	std::vector<AccessPoint> points_;
+	std::uint64_t file_size_ = 0;
+	std::uint64_t size_ = 0;
+	std::uint64_t message_count_ = 0;
+	std::uint64_t span_ = 0;
+
+}; // class GzipIndex
+
+// Inflates a .gz file sequentially, either from the start or from an access point. Meant to
+// be the read function of a stream::BlockStream (or StreamParser), e.g.
+//     [&gz](std::uint8_t* buf, std::size_t size) { return gz.read(buf, size); }
+class GzipReader {
+
+public:
+	// From the start. Files of several members (e.g. concatenated .gz files) are read through.
+	explicit GzipReader(const std::string& filepath);
+
+	// From the given point of an index built for this file.
+	GzipReader(const std::string& filepath, const AccessPoint& point);
+
+	GzipReader(const GzipReader&) = delete;
+	GzipReader& operator=(const GzipReader&) = delete;
+	GzipReader(const GzipReader&&) = delete;
+	GzipReader& operator=(const GzipReader&&) = delete;
+
+	~GzipReader();
+
+	// Inflates up to size bytes into buf and returns how many; 0 means the end. Throws if the
+	// file is corrupt or truncated.
+	std::size_t read(std::uint8_t* buf, std::size_t size);
+
+	// Inflates and drops size bytes. Throws if the data ends first.
+	void skip(std::uint64_t size);
+
+	// Offset in the uncompressed data of the next byte read() returns.
+	[[nodiscard]] std::uint64_t position() const noexcept;
+
+private:
+	struct State; // Keeps zlib out of this header.
+	std::unique_ptr<State> state;
+
+}; // class GzipReader
+
+} // namespace itch::gzip
+
+#endif // TV_ITCH50_CPP_GZIP_HPP
@@ -0,0 +1,114 @@
+#ifndef TV_ITCH50_CPP_INDEX_HPP
+#define TV_ITCH50_CPP_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace itch::index {
+
+// Whether the index records a checkpoint every N messages or every N bytes.
+enum StrideKind : std::uint8_t {
+	MESSAGES = 0,
+	BYTES    = 1
+};
+
+// An index of message offsets into an ITCH file. Every offset points to the 2-byte length
+// field of a message, so any of them is a valid place to start (or stop) parsing. The first
+// offset is always zero. The index is saved to a sidecar file next to the input so that the
+// (sequential) build only has to be done once per file.
+class MessageIndex {
+
+public:
+	static constexpr std::uint64_t DEFAULT_STRIDE = 1u << 20; // Every ~1M messages.
+
+	MessageIndex() = default;
+
+	// Walks the whole range once and records a checkpoint every stride messages or bytes.
+	static MessageIndex build(
+		const std::uint8_t* data,
+		std::size_t size,
+		std::uint64_t stride = DEFAULT_STRIDE,
+		StrideKind kind = MESSAGES
+	);
+
+	// Loads the sidecar of the given file. Throws if it's missing, corrupt, or if it was
+	// built for a file of a different size or modification time.
+	static MessageIndex load(const std::string& filepath, std::size_t file_size);
+
+	// Loads the sidecar if it's usable and every checkpoint in it passes is_chain_start(),
+	// otherwise builds the index and tries to save it. Failing to write the sidecar (e.g.
+	// read-only directory) is not an error.
+	static MessageIndex load_or_build(
+		const std::string& filepath,
+		const std::uint8_t* data,
+		std::size_t size,
+		std::uint64_t stride = DEFAULT_STRIDE,
+		StrideKind kind = MESSAGES
+	);
+
+	// Replaces the sidecar as a whole: a crash leaves either the old one or the new one.
+	void save(const std::string& filepath) const;
+
+	// The sidecar path used for the given input file: "<filepath>.idx"
+	[[nodiscard]] static std::string sidecar_path(const std::string& filepath);
+
+	[[nodiscard]] const std::vector<std::uint64_t>& offsets() const noexcept { return offsets_; }
+	[[nodiscard]] std::uint64_t file_size() const noexcept { return file_size_; }
+	[[nodiscard]] std::uint64_t message_count() const noexcept { return message_count_; }
+	[[nodiscard]] std::uint64_t stride() const noexcept { return stride_; }
+	[[nodiscard]] StrideKind stride_kind() const noexcept { return kind_; }
+
+	// Returns the smallest checkpoint >= byte_offset, or file_size() if there is none.
+	[[nodiscard]] std::uint64_t next_checkpoint(std::uint64_t byte_offset) const noexcept;
+
+private:
+	std::vector<std::uint64_t> offsets_;
+	std::uint64_t file_size_ = 0;
+	std::uint64_t message_count_ = 0;
+	std::uint64_t stride_ = 0;
+	StrideKind kind_ = MESSAGES;
+
+}; // class MessageIndex
+
+// Finds message boundaries from an arbitrary byte, with no index: a candidate offset is
+// accepted only if it starts a chain of hops consecutive messages whose length fields match
+// the spec length of their type byte (spec::MESSAGE_LENGTH), or a shorter chain that ends
+// exactly at the end of the data. A false match needs hops * 3 bytes to line up by chance.
+inline constexpr std::size_t DEFAULT_RESYNC_HOPS = 8;
+
+// Whether pos passes the chain check above.
+[[nodiscard]] bool is_chain_start(
+	const std::uint8_t* data,
+	std::size_t size,
+	std::uint64_t pos,
+	std::size_t hops = DEFAULT_RESYNC_HOPS
+) noexcept;
+
+// Returns the first offset >= from that passes the chain check above, or size if none does.
+[[nodiscard]] std::uint64_t resync(
+	const std::uint8_t* data,
+	std::size_t size,
+	std::uint64_t from,
+	std::size_t hops = DEFAULT_RESYNC_HOPS
+) noexcept;
+
+// Cuts the data into k chunks of roughly equal size and resyncs every cut. Returns k + 1
+// offsets: the first is 0 and the last is size. A cut is only proven right once the chunk
+// before it has been walked and ends exactly on it.
+[[nodiscard]] std::vector<std::uint64_t> split(
+	const std::uint8_t* data,
+	std::size_t size,
+	std::size_t k,
+	std::size_t hops = DEFAULT_RESYNC_HOPS
+);
+
+// Tag for splitting by resync() instead of by a MessageIndex.
+struct Resync {
+	std::size_t hops = DEFAULT_RESYNC_HOPS;
+};
+
+} // namespace itch::index
+
+#endif // TV_ITCH50_CPP_INDEX_HPP
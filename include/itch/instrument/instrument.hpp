@@ -0,0 +1,125 @@
+#ifndef TV_ITCH50_CPP_INSTRUMENT_HPP
+#define TV_ITCH50_CPP_INSTRUMENT_HPP
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+// Per message type counts and handler timings, recorded by policy::Instrumented (see
+// itch/dispatch.hpp). Building with TV_ITCH50_CPP_INSTRUMENT (the CMake option of the same
+// name) makes it the default policy of every parser, and prints the totals to stderr at exit.
+// Without it, nothing here is reached unless asked for by name.
+namespace itch::instrument {
+
+#ifdef TV_ITCH50_CPP_INSTRUMENT
+inline constexpr bool ENABLED = true;
+#else
+inline constexpr bool ENABLED = false;
+#endif
+
+// Time stamp counter ticks on x86, which run at the nominal clock rate whatever the core is
+// doing; steady_clock nanoseconds elsewhere.
+[[nodiscard]] inline std::uint64_t now() noexcept {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	return __rdtsc();
+#else
+	return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Unit of now(), for reports.
+inline constexpr const char* TICKS =
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	"cycles";
+#else
+	"ns";
+#endif
+
+// Power-of-two buckets: bucket b counts values in [2^(b-1), 2^b), bucket 0 counts zeros and
+// the last bucket everything from 2^(BUCKETS-2) up.
+class Histogram {
+
+public:
+	static constexpr std::size_t BUCKETS = 32;
+
+	void add(const std::uint64_t value) noexcept {
+		const std::size_t b = static_cast<std::size_t>(std::bit_width(value));
+		++buckets[b < BUCKETS ? b : BUCKETS - 1];
+	}
+
+	[[nodiscard]] std::uint64_t operator[](const std::size_t b) const noexcept { return buckets[b]; }
+
+	// Upper bound of the bucket holding the q-th quantile, q in [0, 1]. 0 when empty.
+	[[nodiscard]] std::uint64_t quantile(double q) const noexcept;
+
+	void merge(const Histogram& other) noexcept {
+		for (std::size_t b = 0; b < BUCKETS; ++b) buckets[b] += other.buckets[b];
+	}
+
+private:
+	std::array<std::uint64_t, BUCKETS> buckets{};
+
+}; // class Histogram
+
+struct TypeStats {
+	std::uint64_t count = 0;
+	std::uint64_t bytes = 0;      // Length fields included.
+	std::uint64_t ticks = 0;      // Summed over the handler calls.
+	std::uint64_t max_ticks = 0;
+	Histogram histogram;          // Ticks per handler call.
+};
+
+// Indexed by type byte. Fixed size, so recording never allocates.
+struct Stats {
+	std::array<TypeStats, 256> types;
+
+	// bytes as framed: the length field read from the input, plus its own 2 bytes.
+	void add(const std::uint8_t type, const std::uint64_t bytes, const std::uint64_t ticks) noexcept {
+		TypeStats& t = types[type];
+		++t.count;
+		t.bytes += bytes;
+		t.ticks += ticks;
+		t.max_ticks = ticks > t.max_ticks ? ticks : t.max_ticks;
+		t.histogram.add(ticks);
+	}
+
+	void merge(const Stats& other) noexcept;
+	void reset() noexcept { types = {}; }
+};
+
+namespace detail {
+
+// The calling thread's Stats. Folded into collected() when the thread exits.
+struct Local {
+	Stats stats;
+	~Local();
+};
+
+} // namespace detail
+
+// The calling thread's counters, as they are being recorded.
+[[nodiscard]] inline Stats& stats() noexcept {
+	thread_local detail::Local local;
+	return local.stats;
+}
+
+// The counters of every thread that has exited, plus those of the calling thread.
+[[nodiscard]] Stats collected();
+
+// A table with a row per type seen (count, bytes, mean, p50, p99 and max ticks per call),
+// followed by the non-empty histogram buckets of each. The cost of reading the clock twice,
+// which every call includes, is measured and shown as the floor.
+[[nodiscard]] std::string report(const Stats& stats);
+
+} // namespace itch::instrument
+
+#endif // TV_ITCH50_CPP_INSTRUMENT_HPP
@@ -11,12 +11,42 @@
 
 namespace itch::mmap {
 
+struct MapOptions {
+	// If non-zero, only a window of about this many bytes is mapped at a time instead of the
+	// whole file, and slide() moves it forward. Memory use is then bounded by two windows
+	// whatever the file size. Must be at least a few pages (64 KB on Windows).
+	std::size_t window = 0;
+
+	// Fault the whole mapping in up front (MAP_POPULATE), so the parser never takes a page
+	// fault. Linux only.
+	bool populate = false;
+
+	// Ask for transparent huge pages on the mapping (MADV_HUGEPAGE). For a file mapping this
+	// only helps if the kernel supports huge pages in the page cache. Linux only.
+	bool huge_pages = false;
+
+	// Read the whole file into anonymous memory backed by huge pages (MAP_HUGETLB if any are
+	// reserved, transparent huge pages otherwise) instead of mapping it. Takes a full read of
+	// the file and as much memory, but then every pass over the data is faster, so it pays off
+	// when the same data is replayed many times. Not with a window. POSIX only.
+	bool copy_to_huge_pages = false;
+};
+
+// Which of the MapOptions actually took effect, since each of them can be refused by the OS
+// (or not exist on it) without the mapping failing.
+struct MapEffects {
+	bool populated = false;
+	bool huge_pages = false;  // The OS accepted the huge page request.
+	bool copied = false;
+	bool hugetlb = false;     // The copy is in MAP_HUGETLB pages rather than transparent ones.
+};
+
 // Note that the mmap classes below are read-only and the data() method returns pointer to const uint8_t.
 #ifdef _WIN32
 class MemoryMapWindows {
 
 public:
-	explicit MemoryMapWindows(const std::string& path);
+	explicit MemoryMapWindows(const std::string& path, MapOptions options = {});
 
 	MemoryMapWindows(const MemoryMapWindows&) = delete;
 	MemoryMapWindows& operator=(const MemoryMapWindows&) = delete;
@@ -29,11 +59,36 @@ public:
 
 	[[nodiscard]] std::size_t size() const noexcept { return size_; }
 
+	// Offset in the file of data(), and the size of the whole file. Without a window, these
+	// are 0 and size().
+	[[nodiscard]] std::size_t offset() const noexcept { return offset_; }
+	[[nodiscard]] std::size_t file_size() const noexcept { return file_size_; }
+	[[nodiscard]] bool is_windowed() const noexcept { return window != 0; }
+	[[nodiscard]] const MapEffects& effects() const noexcept { return effects_; }
+
+	// Maps the window starting at file_offset (rounded down to the OS granularity), which
+	// must be less than file_size(). The previous window stays mapped until the next slide,
+	// so pointers into it stay valid for that long. Does nothing without a window.
+	void slide(std::size_t file_offset);
+
+	// Paging hints for [offset, offset + length), rounded out to whole pages. will_need()
+	// starts reading the range into the page cache without waiting for it. dont_need() drops
+	// the range from this mapping and, where the OS allows, from the page cache; the data
+	// stays valid and is read again if touched. Both are best effort and never fail.
+	void will_need(std::size_t offset, std::size_t length) const noexcept;
+	void dont_need(std::size_t offset, std::size_t length) const noexcept;
+
 private:
 	HANDLE file = INVALID_HANDLE_VALUE;
 	HANDLE mapping = nullptr;
 	void* data_ = nullptr;
 	std::size_t size_ = 0;
+	std::size_t offset_ = 0;
+	std::size_t file_size_ = 0;
+	std::size_t window = 0;
+	std::size_t granularity = 0;
+	void* prev_data = nullptr; // Previous window, if any.
+	MapEffects effects_;
 
 }; // class MemoryMapWindows
 
@@ -41,7 +96,7 @@ private:
 class MemoryMapPosix {
 
 public:
-	explicit MemoryMapPosix(const std::string& path);
+	explicit MemoryMapPosix(const std::string& path, MapOptions options = {});
 
 	MemoryMapPosix(const MemoryMapPosix&) = delete;
 	MemoryMapPosix& operator=(const MemoryMapPosix&) = delete;
@@ -54,10 +109,46 @@ public:
 
 	[[nodiscard]] std::size_t size() const noexcept { return size_; }
 
+	// Offset in the file of data(), and the size of the whole file. Without a window, these
+	// are 0 and size().
+	[[nodiscard]] std::size_t offset() const noexcept { return offset_; }
+	[[nodiscard]] std::size_t file_size() const noexcept { return file_size_; }
+	[[nodiscard]] bool is_windowed() const noexcept { return window != 0; }
+	[[nodiscard]] const MapEffects& effects() const noexcept { return effects_; }
+
+	// Maps the window starting at file_offset (rounded down to the OS granularity), which
+	// must be less than file_size(). The previous window stays mapped until the next slide,
+	// so pointers into it stay valid for that long. Does nothing without a window.
+	void slide(std::size_t file_offset);
+
+	// Paging hints for [offset, offset + length), rounded out to whole pages. will_need()
+	// starts reading the range into the page cache without waiting for it. dont_need() drops
+	// the range from this mapping and, where the OS allows, from the page cache; the data
+	// stays valid and is read again if touched. Both are best effort and never fail.
+	void will_need(std::size_t offset, std::size_t length) const noexcept;
+	void dont_need(std::size_t offset, std::size_t length) const noexcept;
+
 private:
 	int fd = -1;
 	void* data_ = nullptr;
 	std::size_t size_ = 0;
+	std::size_t offset_ = 0;
+	std::size_t file_size_ = 0;
+	std::size_t window = 0;
+	std::size_t granularity = 0;
+	void* prev_data = nullptr; // Previous window, if any.
+	std::size_t prev_size = 0;
+	bool populate = false;
+	bool huge_pages = false;
+	MapEffects effects_;
+	void* copy = nullptr;       // Region holding the copy, if copied (data_ is aligned in it).
+	std::size_t copy_size = 0;
+
+	// Maps [offset, offset + length) of the file with the options above. Returns nullptr if
+	// mmap fails.
+	void* map_range(std::size_t offset, std::size_t length);
+	// Returns false (and frees what it took) if it fails.
+	bool copy_file() noexcept;
 
 }; // class MemoryMapPosix
 #endif
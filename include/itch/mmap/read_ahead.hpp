@@ -0,0 +1,67 @@
+#ifndef TV_ITCH50_CPP_READ_AHEAD_HPP
+#define TV_ITCH50_CPP_READ_AHEAD_HPP
+
+#include "itch/mmap/mmap.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+namespace itch::mmap {
+
+struct ReadAheadWindow {
+	std::size_t ahead = 0;                // Bytes kept requested ahead of the reader; 0 is off.
+	std::size_t step = 4u << 20;          // Granularity of published positions and hints.
+	bool drop_behind = false;             // Evict what the reader has passed.
+	std::size_t keep_behind = 16u << 20;  // Bytes right behind the reader that are never dropped.
+};
+
+// Companion thread that keeps the page cache ahead of a sequential reader of a MemoryMap, so
+// that disk reads overlap with parsing instead of stalling the reader on page faults. The
+// reader publishes its offset every window.step bytes or so, and the thread requests the
+// next window.ahead bytes with MemoryMap::will_need(). With window.drop_behind, it also
+// drops what's more than window.keep_behind bytes behind the reader, so a full day doesn't
+// evict everything else from memory. Dropping never breaks the reader, only slows it down
+// if it goes back: dropped pages are read again on access.
+class ReadAhead {
+
+public:
+	ReadAhead(const MemoryMap& map, ReadAheadWindow window);
+
+	ReadAhead(const ReadAhead&) = delete;
+	ReadAhead& operator=(const ReadAhead&) = delete;
+	ReadAhead(const ReadAhead&&) = delete;
+	ReadAhead& operator=(const ReadAhead&&) = delete;
+
+	~ReadAhead();
+
+	// Offset of the reader in the mapping. Wakes the thread up, so call it every step() bytes
+	// rather than every message.
+	void publish(const std::size_t offset) noexcept {
+		position.store(offset, std::memory_order_release);
+		position.notify_one();
+	}
+
+	[[nodiscard]] std::size_t step() const noexcept { return window.step; }
+
+	// Bytes requested and dropped so far.
+	[[nodiscard]] std::size_t advised_bytes() const noexcept { return advised.load(std::memory_order_relaxed); }
+	[[nodiscard]] std::size_t dropped_bytes() const noexcept { return dropped.load(std::memory_order_relaxed); }
+
+private:
+	static constexpr std::size_t STOP = ~std::size_t{0};
+
+	const MemoryMap& map;
+	const ReadAheadWindow window;
+	std::atomic<std::size_t> position{0};
+	std::atomic<std::size_t> advised{0};
+	std::atomic<std::size_t> dropped{0};
+	std::thread worker;
+
+	void run() noexcept;
+
+}; // class ReadAhead
+
+} // namespace itch::mmap
+
+#endif // TV_ITCH50_CPP_READ_AHEAD_HPP
@@ -0,0 +1,279 @@
+#ifndef TV_ITCH50_CPP_MOLD_ARBITER_HPP
+#define TV_ITCH50_CPP_MOLD_ARBITER_HPP
+
+#include "itch/dispatch.hpp"
+#include "itch/mold/mold.hpp"
+#include "itch/mold/receiver.hpp"
+#include "itch/pcap/pcap.hpp"
+#include "itch/util/util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace itch::mold {
+
+enum Line : std::uint8_t {
+	LINE_A = 0,
+	LINE_B = 1
+};
+
+struct ArbiterStats {
+	std::array<std::uint64_t, 2> first = {};  // Packets per line that delivered something.
+	std::uint64_t duplicates = 0;             // Packets with nothing new, dropped.
+	std::uint64_t gaps = 0;                   // Gaps both lines missed.
+};
+
+// Merges the A and B lines of a MoldUDP64 feed, which carry the same packets: the first copy
+// of each message to arrive, on either line, goes straight to the handler, and later copies
+// are dropped. Nothing is copied or held. Messages delivered ahead of a loss on the other
+// line are marked in a bitmap of the next window sequence numbers; the common case, a line
+// that is in step, never touches it, and the copy from the slower line is dropped after one
+// compare.
+//
+// So when one line loses a packet, the messages after it can reach the handler before the
+// other line's copy of it. A gap is only reported (through the handler's optional onGap, as
+// with Decoder) once both lines are past it, or once it falls out of the window, which is
+// also how a line that went quiet is noticed. For a single line, use a Decoder.
+template <class Handler, class DispatchPolicy = policy::Default>
+class Arbiter {
+
+public:
+	static constexpr std::size_t DEFAULT_WINDOW = 1u << 14;
+
+private:
+	Handler& handler;
+	std::vector<std::uint64_t> bits;
+	const std::uint64_t window;
+	std::uint64_t next;      // Everything before this was delivered, or reported as a gap.
+	std::uint64_t top;       // One past the highest sequence number delivered. Bits are only
+	                         // set in [next, top).
+	std::array<std::uint64_t, 2> line_end = {};  // One past the highest sequence number per line.
+	std::uint64_t session_end = std::numeric_limits<std::uint64_t>::max();
+	std::array<char, SESSION_SIZE> session_{};
+	bool has_session = false;
+	ArbiterStats stats_;
+
+	[[nodiscard]] std::uint64_t& word(const std::uint64_t seq) noexcept {
+		return bits[(seq & (window - 1)) >> 6];
+	}
+	[[nodiscard]] bool is_set(const std::uint64_t seq) noexcept {
+		return (word(seq) >> (seq & 63)) & 1;
+	}
+
+	// Moves next up to sequence: delivered messages are passed (clearing their bits), and runs
+	// of missing ones are reported as gaps.
+	void skipTo(const std::uint64_t sequence, PacketResult& result) {
+		while (next < sequence) {
+			if (next < top && is_set(next)) {
+				word(next) &= ~(std::uint64_t{1} << (next & 63));
+				++next;
+				continue;
+			}
+
+			const std::uint64_t first = next;
+			while (next < sequence && !(next < top && is_set(next))) {
+				++next;
+			}
+			const Gap gap{first, next - first};
+			if (result.gap.count == 0) result.gap = gap;
+			++stats_.gaps;
+			if constexpr (requires (Handler h, Gap g) {h.onGap(g);}) {
+				handler.onGap(gap);
+			}
+		}
+		top = std::max(top, next);
+	}
+
+	// Reports what both lines have gone past.
+	void settle(PacketResult& result) {
+		const std::uint64_t passed = std::min(line_end[LINE_A], line_end[LINE_B]);
+		if (next < passed) skipTo(passed, result);
+	}
+
+public:
+	// next_sequence is the first message expected; sessions start at 1. window is how far
+	// (in messages) one line may run ahead of a loss on the other; a power of two, at least 64.
+	explicit Arbiter(Handler& h, const std::uint64_t next_sequence = 1, const std::size_t window_size = DEFAULT_WINDOW)
+	: handler(h)
+	, bits(window_size / 64)
+	, window(window_size)
+	, next(next_sequence)
+	, top(next_sequence)
+	{
+		if (window_size < 64 || (window_size & (window_size - 1)) != 0)
+			throw std::runtime_error("Arbiter error: window must be a power of two, at least 64");
+	}
+
+	Arbiter(const Arbiter&) = delete;
+	Arbiter& operator=(const Arbiter&) = delete;
+	Arbiter(const Arbiter&&) = delete;
+	Arbiter& operator=(const Arbiter&&) = delete;
+
+	// Takes one UDP payload from a line; the handler has seen its new messages by the time
+	// this returns. Statuses are those of Decoder::decode().
+	PacketResult arbitrate(const std::span<const std::uint8_t> payload, const Line line) {
+		PacketResult result;
+		if (payload.size() < HEADER_SIZE) {
+			result.status = MALFORMED;
+			return result;
+		}
+
+		const PacketView packet(payload.data());
+		const std::string_view session = packet.session();
+		if (!has_session) {
+			std::copy(session.begin(), session.end(), session_.begin());
+			has_session = true;
+		} else if (session != this->session()) {
+			result.status = OTHER_SESSION;
+			return result;
+		}
+
+		const std::uint64_t sequence = packet.sequence();
+		const std::uint16_t count = packet.count();
+
+		if (count == 0 || count == END_OF_SESSION) {
+			line_end[line] = std::max(line_end[line], sequence);
+			if (count == END_OF_SESSION) session_end = sequence;
+			settle(result);
+			result.status = count == 0 ? HEARTBEAT : SESSION_END;
+			return result;
+		}
+
+		const std::uint64_t end = sequence + count;
+		if (end <= next) {
+			// The other line's copy came first.
+			++stats_.duplicates;
+			result.status = DUPLICATE;
+			return result;
+		}
+
+		if (!frames_fit(payload, count)) {
+			result.status = MALFORMED;
+			return result;
+		}
+		line_end[line] = std::max(line_end[line], end);
+
+		// The window only reaches so far: what's missing before it now is given up on.
+		if (end - next > window) skipTo(end - window, result);
+
+		const std::uint8_t* ptr = packet.messages();
+		if (sequence <= next && top <= next) {
+			// In step, and nothing delivered ahead: no bits involved.
+			for (std::uint64_t seq = sequence; seq < end; ++seq) {
+				const auto msg_len = util::read_be<std::uint16_t>(ptr);
+				if (seq >= next) {
+					policy::dispatch<DispatchPolicy>(handler, ptr + 2, msg_len);
+					++result.delivered;
+				}
+				ptr += 2 + msg_len;
+			}
+			next = end;
+			top = end;
+		} else {
+			for (std::uint64_t seq = sequence; seq < end; ++seq) {
+				const auto msg_len = util::read_be<std::uint16_t>(ptr);
+				if (seq >= next && !is_set(seq)) {
+					word(seq) |= std::uint64_t{1} << (seq & 63);
+					policy::dispatch<DispatchPolicy>(handler, ptr + 2, msg_len);
+					++result.delivered;
+				}
+				ptr += 2 + msg_len;
+			}
+			top = std::max(top, end);
+			while (next < top && is_set(next)) {
+				word(next) &= ~(std::uint64_t{1} << (next & 63));
+				++next;
+			}
+		}
+
+		settle(result);
+		if (result.delivered != 0) {
+			++stats_.first[line];
+			result.status = DELIVERED;
+		} else {
+			++stats_.duplicates;
+			result.status = DUPLICATE;
+		}
+		return result;
+	}
+
+	// Sequence number of the lowest message not yet delivered.
+	[[nodiscard]] std::uint64_t next_sequence() const noexcept { return next; }
+
+	// Empty until the first packet is accepted.
+	[[nodiscard]] std::string_view session() const noexcept {
+		return {session_.data(), has_session ? SESSION_SIZE : 0};
+	}
+
+	// Whether an end-of-session packet arrived, and everything before it was delivered or
+	// reported as a gap.
+	[[nodiscard]] bool ended() const noexcept { return next >= session_end; }
+
+	[[nodiscard]] const ArbiterStats& stats() const noexcept { return stats_; }
+
+}; // class Arbiter
+
+// Receives both lines and arbitrates until stop is set (checked at least every 100ms) or the
+// session ends. Returns whether it ended.
+template <class Handler, class DispatchPolicy>
+bool run(Receiver& a, Receiver& b, Arbiter<Handler, DispatchPolicy>& arbiter, const std::atomic<bool>& stop) {
+	Receiver* const lines[] = {&a, &b};
+	while (!stop.load(std::memory_order_relaxed)) {
+		if (!wait_any(lines, 100)) continue;
+		for (const auto packet : a.receive_queued()) {
+			arbiter.arbitrate(packet, LINE_A);
+		}
+		for (const auto packet : b.receive_queued()) {
+			arbiter.arbitrate(packet, LINE_B);
+		}
+		if (arbiter.ended()) return true;
+	}
+	return false;
+}
+
+// A line recorded in a capture: the UDP datagrams to this IPv4 address (host order) and port.
+// 0 in either matches anything.
+struct CaptureLine {
+	std::uint32_t group = 0;
+	std::uint16_t port = 0;
+};
+
+// Arbitrates the A and B lines recorded in a pcap or pcapng capture, in capture order, until
+// the capture or the session ends. Datagrams on neither line are ignored, and one that matches
+// both goes to A, so the two must differ. Returns whether the session ended.
+template <class Handler, class DispatchPolicy>
+bool run(pcap::Capture& capture, const CaptureLine& a, const CaptureLine& b, Arbiter<Handler, DispatchPolicy>& arbiter) {
+	if (a.group == b.group && a.port == b.port)
+		throw std::runtime_error("Arbiter error: the capture lines A and B must differ");
+
+	const auto on = [](const CaptureLine& line, const pcap::Datagram& d) noexcept {
+		return (line.group == 0 || d.destination == line.group) && (line.port == 0 || d.destination_port == line.port);
+	};
+
+	pcap::Frame frame;
+	pcap::Datagram datagram;
+	while (capture.next(frame)) {
+		if (!pcap::parse_udp(frame, datagram)) continue;
+		if (on(a, datagram)) {
+			arbiter.arbitrate(datagram.payload, LINE_A);
+		} else if (on(b, datagram)) {
+			arbiter.arbitrate(datagram.payload, LINE_B);
+		} else {
+			continue;
+		}
+		if (arbiter.ended()) return true;
+	}
+	return false;
+}
+
+} // namespace itch::mold
+
+#endif // TV_ITCH50_CPP_MOLD_ARBITER_HPP
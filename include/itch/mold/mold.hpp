@@ -0,0 +1,192 @@
+#ifndef TV_ITCH50_CPP_MOLD_HPP
+#define TV_ITCH50_CPP_MOLD_HPP
+
+#include "itch/dispatch.hpp"
+#include "itch/util/util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace itch::mold {
+
+// MoldUDP64 packet: a 20-byte header (10-byte session, 8-byte sequence number of the first
+// message, 2-byte message count), then count message blocks framed exactly like an ITCH
+// file: a 2-byte length, then the message. All big-endian.
+inline constexpr std::size_t SESSION_SIZE = 10;
+inline constexpr std::size_t HEADER_SIZE = 20;
+inline constexpr std::uint16_t END_OF_SESSION = 0xFFFF; // Message count of the last packet.
+// A re-request is just a header, sent to the retransmission server: session, first sequence
+// number, message count. The answer is ordinary packets holding those messages.
+inline constexpr std::size_t REQUEST_SIZE = HEADER_SIZE;
+
+// Zero-copy view of a packet header. Does not check anything; see Decoder for that.
+class PacketView {
+
+public:
+	explicit PacketView(const std::uint8_t* p) noexcept : ptr(p) {/*no-op*/}
+
+	[[nodiscard]] std::string_view session() const noexcept {
+		return {static_cast<const char*>(static_cast<const void*>(ptr)), SESSION_SIZE};
+	}
+
+	// Of the first message in the packet or, for heartbeats and the end of session, of the
+	// next message the server will send.
+	[[nodiscard]] std::uint64_t sequence() const noexcept { return util::read_be<std::uint64_t>(ptr + 10); }
+	[[nodiscard]] std::uint16_t count() const noexcept { return util::read_be<std::uint16_t>(ptr + 18); }
+
+	[[nodiscard]] bool is_heartbeat() const noexcept { return count() == 0; }
+	[[nodiscard]] bool is_end_of_session() const noexcept { return count() == END_OF_SESSION; }
+
+	// The first message block, at its length field.
+	[[nodiscard]] const std::uint8_t* messages() const noexcept { return ptr + HEADER_SIZE; }
+
+private:
+	const std::uint8_t* ptr;
+
+}; // class PacketView
+
+// Whether count message blocks, starting at the first one, fit in the payload. A packet is
+// checked with this before any of its messages are handed over.
+[[nodiscard]] inline bool frames_fit(const std::span<const std::uint8_t> payload, const std::uint16_t count) noexcept {
+	const std::uint8_t* const end = payload.data() + payload.size();
+	const std::uint8_t* ptr = payload.data() + HEADER_SIZE;
+	for (std::uint16_t i = 0; i < count; ++i) {
+		if (end - ptr < 2 || end - ptr - 2 < util::read_be<std::uint16_t>(ptr)) return false;
+		ptr += 2 + util::read_be<std::uint16_t>(ptr);
+	}
+	return true;
+}
+
+// Messages [first, first + count) never arrived.
+struct Gap {
+	std::uint64_t first = 0;
+	std::uint64_t count = 0;
+};
+
+enum PacketStatus : std::uint8_t {
+	DELIVERED      = 0, // At least one new message was handed to the handler.
+	DUPLICATE      = 1, // Every message in it was seen already.
+	HEARTBEAT      = 2,
+	SESSION_END    = 3,
+	MALFORMED      = 4, // Too short, or the messages don't fit; nothing was delivered.
+	OTHER_SESSION  = 5  // Not the session the decoder is following; ignored.
+};
+
+struct PacketResult {
+	PacketStatus status = DELIVERED;
+	std::uint16_t delivered = 0; // Messages handed to the handler.
+	Gap gap;                     // What this packet revealed as missing; count 0 if nothing.
+};
+
+// Decodes MoldUDP64 packets in place and hands their messages to the same handlers Parser
+// uses, in sequence order. It follows the session of the first packet it accepts, drops
+// messages it has already delivered (so overlapping retransmissions are fine), and reports a
+// gap whenever a packet, heartbeat or end of session shows that messages were skipped. A
+// Handler that defines
+//     void onGap( const itch::mold::Gap g );
+// is told about gaps as they're found, before the messages after them.
+template <class Handler, class DispatchPolicy = policy::Default>
+class Decoder {
+
+private:
+	Handler& handler;
+	std::uint64_t expected;  // Sequence number of the next message to deliver.
+	std::array<char, SESSION_SIZE> session_{};
+	bool has_session = false;
+	bool is_ended = false;
+
+	void reportGap(PacketResult& result, const std::uint64_t next) {
+		if (next <= expected) return;
+
+		result.gap = {expected, next - expected};
+		if constexpr (requires (Handler h, Gap g) {h.onGap(g);}) {
+			handler.onGap(result.gap);
+		}
+		expected = next;
+	}
+
+public:
+	// next_sequence is the first message expected; sessions start at 1.
+	explicit Decoder(Handler& h, const std::uint64_t next_sequence = 1) noexcept
+	: handler(h)
+	, expected(next_sequence)
+	{/*no-op*/}
+
+	Decoder(const Decoder&) = delete;
+	Decoder& operator=(const Decoder&) = delete;
+	Decoder(const Decoder&&) = delete;
+	Decoder& operator=(const Decoder&&) = delete;
+
+	// Decodes one UDP payload; the handler has seen its new messages by the time this returns.
+	PacketResult decode(const std::span<const std::uint8_t> payload) noexcept {
+		PacketResult result;
+		if (payload.size() < HEADER_SIZE) {
+			result.status = MALFORMED;
+			return result;
+		}
+
+		const PacketView packet(payload.data());
+		const std::string_view session = packet.session();
+		if (!has_session) {
+			std::copy(session.begin(), session.end(), session_.begin());
+			has_session = true;
+		} else if (session != this->session()) {
+			result.status = OTHER_SESSION;
+			return result;
+		}
+
+		const std::uint64_t sequence = packet.sequence();
+		const std::uint16_t count = packet.count();
+
+		if (count == 0 || count == END_OF_SESSION) {
+			reportGap(result, sequence);
+			if (count == END_OF_SESSION) is_ended = true;
+			result.status = count == 0 ? HEARTBEAT : SESSION_END;
+			return result;
+		}
+
+		if (!frames_fit(payload, count)) {
+			result.status = MALFORMED;
+			return result;
+		}
+
+		if (sequence + count <= expected) {
+			result.status = DUPLICATE;
+			return result;
+		}
+		reportGap(result, sequence);
+
+		const std::uint8_t* ptr = packet.messages();
+		for (std::uint64_t seq = sequence; seq < sequence + count; ++seq) {
+			const auto msg_len = util::read_be<std::uint16_t>(ptr);
+			if (seq >= expected) {
+				policy::dispatch<DispatchPolicy>(handler, ptr + 2, msg_len);
+				++result.delivered;
+			}
+			ptr += 2 + msg_len;
+		}
+
+		expected = sequence + count;
+		return result;
+	}
+
+	// Sequence number of the next message to deliver.
+	[[nodiscard]] std::uint64_t next_sequence() const noexcept { return expected; }
+
+	// Empty until the first packet is accepted.
+	[[nodiscard]] std::string_view session() const noexcept {
+		return {session_.data(), has_session ? SESSION_SIZE : 0};
+	}
+
+	// Whether the end-of-session packet has arrived.
+	[[nodiscard]] bool ended() const noexcept { return is_ended; }
+
+}; // class Decoder
+
+} // namespace itch::mold
+
+#endif // TV_ITCH50_CPP_MOLD_HPP
@@ -0,0 +1,65 @@
+#ifndef TV_ITCH50_CPP_MOLD_PACKER_HPP
+#define TV_ITCH50_CPP_MOLD_PACKER_HPP
+
+#include "itch/mold/mold.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace itch::mold {
+
+// Builds MoldUDP64 packets, numbering messages from first_sequence. A packet holds as many
+// messages as fit in max_size bytes (header included) and max_messages; a message too long
+// for max_size on its own still gets a packet to itself.
+class Packer {
+
+public:
+	static constexpr std::size_t DEFAULT_MAX_SIZE = 1400; // Fits an Ethernet MTU.
+
+	// session is padded with spaces, or cut, to SESSION_SIZE.
+	explicit Packer(
+		std::string_view session,
+		std::uint64_t first_sequence = 1,
+		std::size_t max_size = DEFAULT_MAX_SIZE,
+		std::uint16_t max_messages = END_OF_SESSION - 1
+	);
+
+	// Whether a message of len bytes (after its length field) fits in the current packet.
+	[[nodiscard]] bool fits(std::size_t len) const noexcept;
+
+	// Appends a message, given at its type byte. Check fits() first, unless empty().
+	void add(const std::uint8_t* msg, std::uint16_t len) noexcept;
+
+	[[nodiscard]] bool empty() const noexcept { return count == 0; }
+	[[nodiscard]] std::size_t size() const noexcept { return used; }
+
+	// Finishes the current packet and starts the next. The span is valid until the next
+	// call that changes the packer.
+	std::span<const std::uint8_t> flush() noexcept;
+
+	// A packet with no messages, carrying the next sequence number, which keeps receivers
+	// aware of the session when there is nothing to send. Only valid while empty().
+	[[nodiscard]] std::span<const std::uint8_t> heartbeat() noexcept;
+	[[nodiscard]] std::span<const std::uint8_t> end_of_session() noexcept;
+
+	// Sequence number of the first message of the current packet.
+	[[nodiscard]] std::uint64_t next_sequence() const noexcept { return sequence; }
+
+private:
+	const std::size_t max_size;
+	const std::uint16_t max_messages;
+	std::vector<std::uint8_t> buffer;
+	std::size_t used = HEADER_SIZE;
+	std::uint16_t count = 0;
+	std::uint64_t sequence;
+
+	std::span<const std::uint8_t> header(std::uint16_t message_count) noexcept;
+
+}; // class Packer
+
+} // namespace itch::mold
+
+#endif // TV_ITCH50_CPP_MOLD_PACKER_HPP
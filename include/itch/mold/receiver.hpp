@@ -0,0 +1,91 @@
+#ifndef TV_ITCH50_CPP_MOLD_RECEIVER_HPP
+#define TV_ITCH50_CPP_MOLD_RECEIVER_HPP
+
+#include "itch/mold/mold.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace itch::mold {
+
+struct ReceiverOptions {
+	std::string address = "0.0.0.0";    // Local address to bind, or a multicast group to join.
+	std::uint16_t port = 0;              // 0 picks a free port; see Receiver::port().
+	std::string interface = "0.0.0.0";  // For multicast: the local interface to join on.
+	unsigned batch = 64;                 // Most packets taken per receive().
+	std::size_t packet_size = 2048;      // Longer packets are cut, and then decode as MALFORMED.
+	int receive_buffer = 8 << 20;        // SO_RCVBUF, so bursts aren't dropped by the kernel.
+	int timeout_ms = 100;                // receive() comes back empty after this; -1 never does.
+	bool busy_poll = false;              // Spin instead of sleeping in the kernel: lower latency,
+	                                     // at the cost of a core.
+};
+
+// A UDP socket that takes packets in batches: on Linux, one recvmmsg() returns everything
+// queued (up to batch) once the first packet arrives. POSIX only; the constructor throws on
+// Windows.
+class Receiver {
+
+public:
+	explicit Receiver(const ReceiverOptions& options);
+
+	Receiver(const Receiver&) = delete;
+	Receiver& operator=(const Receiver&) = delete;
+	Receiver(const Receiver&&) = delete;
+	Receiver& operator=(const Receiver&&) = delete;
+
+	~Receiver();
+
+	// Waits for a packet, then returns it along with every other one already queued. The
+	// payloads are valid until the next call. Empty on timeout or when a signal interrupts
+	// the wait.
+	std::span<const std::span<const std::uint8_t>> receive();
+
+	// What's already queued, without waiting: empty if nothing is. Same lifetime as receive().
+	std::span<const std::span<const std::uint8_t>> receive_queued();
+
+	// The bound port, which is useful when ReceiverOptions::port was 0.
+	[[nodiscard]] std::uint16_t port() const noexcept { return port_; }
+	[[nodiscard]] int fd() const noexcept { return fd_; }
+
+private:
+	struct Batch; // Keeps the socket headers out of this one.
+
+	int fd_ = -1;
+	std::uint16_t port_ = 0;
+	const std::size_t packet_size;
+	const int timeout_ms;
+	const bool busy_poll;
+	std::unique_ptr<std::uint8_t[]> buffers;
+	std::vector<std::span<const std::uint8_t>> packets;
+	std::unique_ptr<Batch> batch;
+
+	// Fills packets and returns how many; 0 with errno set if none came.
+	unsigned take(bool wait);
+
+}; // class Receiver
+
+// Waits up to timeout_ms (-1: forever, 0: not at all) for a packet on any of the receivers;
+// take them with receive_queued() on each. Returns false on timeout. Takes up to 8 receivers.
+bool wait_any(std::span<Receiver* const> receivers, int timeout_ms);
+
+// Receives and decodes until stop is set (checked between batches, so within a timeout) or
+// the session ends. Returns whether it ended.
+template <class Handler, class DispatchPolicy>
+bool run(Receiver& receiver, Decoder<Handler, DispatchPolicy>& decoder, const std::atomic<bool>& stop) {
+	while (!stop.load(std::memory_order_relaxed)) {
+		for (const auto packet : receiver.receive()) {
+			decoder.decode(packet);
+			if (decoder.ended()) return true;
+		}
+	}
+	return false;
+}
+
+} // namespace itch::mold
+
+#endif // TV_ITCH50_CPP_MOLD_RECEIVER_HPP
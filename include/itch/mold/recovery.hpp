@@ -0,0 +1,300 @@
+#ifndef TV_ITCH50_CPP_MOLD_RECOVERY_HPP
+#define TV_ITCH50_CPP_MOLD_RECOVERY_HPP
+
+#include "itch/dispatch.hpp"
+#include "itch/mold/mold.hpp"
+#include "itch/mold/receiver.hpp"
+#include "itch/mold/sender.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace itch::mold {
+
+struct RecoveryOptions {
+	std::string address = "127.0.0.1";   // Re-request server.
+	std::uint16_t port = 0;
+	std::size_t max_packets = 4096;       // Packets held while a gap is open.
+	std::size_t packet_size = 2048;       // Longest packet that can be held.
+	int timeout_ms = 20;                  // Wait this long for an answer before asking again.
+	unsigned max_requests = 5;            // Asks per gap before giving up on it.
+};
+
+struct RecoveryStats {
+	std::uint64_t requests = 0;      // Re-requests sent.
+	std::uint64_t held = 0;          // Packets held back behind a gap.
+	std::uint64_t abandoned = 0;     // Gaps given up on, and reported to the handler.
+	std::uint64_t overflows = 0;     // Of those, the ones given up on because the store was full.
+};
+
+// Sits in front of a Decoder and keeps messages in sequence order across losses: a packet
+// that arrives past a gap is held in a store allocated up front, the missing messages are
+// re-requested from the server (again after timeout_ms, up to max_requests times), and held
+// packets are decoded as soon as the gap is filled. Only a gap that can't be filled (no
+// answer, or the store full) reaches the handler's onGap, as with a bare Decoder.
+// Nothing is allocated after construction.
+//
+// Feed it packets with onPacket() (from a Receiver, or an arbiter of A/B lines), and call
+// poll() often, also while the feed is quiet, to take in retransmissions and time out
+// requests. run() below does both.
+template <class Handler, class DispatchPolicy = policy::Default>
+class Recovery {
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Held {
+		std::uint64_t first; // Sequence number of its first message.
+		std::uint32_t slot;
+		std::uint32_t size;
+	};
+
+	const RecoveryOptions options;
+	Decoder<Handler, DispatchPolicy> decoder;
+	Receiver replies;  // Retransmissions come back to the socket requests are sent from.
+	Sender requests;
+
+	std::unique_ptr<std::uint8_t[]> arena;
+	std::vector<Held> held;              // Sorted by first, descending: next one at the back.
+	std::vector<std::uint32_t> free_slots;
+
+	std::array<char, SESSION_SIZE> session{};
+	bool has_session = false;
+	std::uint64_t target;                // One past the highest sequence number known to exist.
+	std::uint64_t session_end = std::numeric_limits<std::uint64_t>::max();
+
+	std::uint64_t oldest = 0;            // The gap being timed: the one at the next sequence number.
+	Clock::time_point asked_at;
+	unsigned asked = 0;                  // Requests for it so far.
+
+	RecoveryStats stats_;
+
+	[[nodiscard]] std::uint8_t* slot_data(const std::uint32_t slot) const noexcept {
+		return arena.get() + static_cast<std::size_t>(slot) * options.packet_size;
+	}
+
+	void decodeHeld() noexcept {
+		const Held h = held.back();
+		held.pop_back();
+		decoder.decode({slot_data(h.slot), h.size});
+		free_slots.push_back(h.slot);
+	}
+
+	// Decodes every held packet that now starts at or before the next sequence number.
+	void drain() noexcept {
+		while (!held.empty() && held.back().first <= decoder.next_sequence()) {
+			decodeHeld();
+		}
+	}
+
+	// A packet header with this session.
+	[[nodiscard]] std::array<std::uint8_t, HEADER_SIZE> header(const std::uint64_t sequence, const std::uint16_t count) const noexcept {
+		std::array<std::uint8_t, HEADER_SIZE> packet{};
+		std::memcpy(packet.data(), session.data(), SESSION_SIZE);
+		for (std::size_t i = 0; i < 8; ++i) {
+			packet[SESSION_SIZE + i] = static_cast<std::uint8_t>(sequence >> (56 - 8 * i));
+		}
+		packet[18] = static_cast<std::uint8_t>(count >> 8);
+		packet[19] = static_cast<std::uint8_t>(count);
+		return packet;
+	}
+
+	// Asks for messages [first, end).
+	void request(std::uint64_t first, const std::uint64_t end) {
+		while (first < end) {
+			const auto count = static_cast<std::uint16_t>(std::min<std::uint64_t>(end - first, END_OF_SESSION - 1));
+			requests.send(header(first, count));
+			++stats_.requests;
+			first += count;
+		}
+	}
+
+	// Skips the gap at the next sequence number: the handler gets onGap, then what's after.
+	void abandon() noexcept {
+		++stats_.abandoned;
+		if (!held.empty()) {
+			decodeHeld();
+		} else {
+			// Nothing held: the gap was revealed by a heartbeat or the end of session, and a
+			// heartbeat moves the decoder past it.
+			decoder.decode(header(target, 0));
+		}
+		drain();
+	}
+
+	// Keeps a packet that's past a gap; the store has a free slot.
+	void hold(const std::span<const std::uint8_t> payload, const std::uint64_t first) noexcept {
+		const auto at = std::lower_bound(held.begin(), held.end(), first,
+			[](const Held& h, const std::uint64_t seq) { return h.first > seq; });
+		if (at != held.end() && at->first == first) return; // Already held.
+
+		const std::uint32_t slot = free_slots.back();
+		free_slots.pop_back();
+		std::memcpy(slot_data(slot), payload.data(), payload.size());
+		held.insert(at, {first, slot, static_cast<std::uint32_t>(payload.size())});
+		++stats_.held;
+	}
+
+	// A packet holding messages [first, end) arrived: asks at once for what it shows to be
+	// missing before it, and moves the target to end.
+	void extend(const std::uint64_t first, const std::uint64_t end) {
+		const std::uint64_t from = std::max(target, decoder.next_sequence());
+		if (from < first) request(from, first);
+		target = std::max(target, end);
+	}
+
+	// Every gap was asked for when it was found, but only the oldest one is timed: it's asked
+	// for again after timeout_ms, and given up on after max_requests.
+	void checkOldest() {
+		for (;;) {
+			const std::uint64_t next = decoder.next_sequence();
+			if (next >= target) return;
+
+			const auto now = Clock::now();
+			if (next != oldest) {
+				oldest = next;
+				asked_at = now;
+				asked = 1;
+				return;
+			}
+			if (now - asked_at < std::chrono::milliseconds(options.timeout_ms)) return;
+
+			if (asked < options.max_requests) {
+				request(next, held.empty() ? target : std::min(target, held.back().first));
+				asked_at = now;
+				++asked;
+				return;
+			}
+			abandon();
+		}
+	}
+
+	static ReceiverOptions replyOptions(const std::size_t packet_size) {
+		ReceiverOptions o;
+		o.packet_size = packet_size;
+		o.busy_poll = true; // With no timeout, receive() just takes what's there.
+		o.timeout_ms = 0;
+		return o;
+	}
+
+	static SenderOptions requestOptions(const RecoveryOptions& options, const int fd) {
+		SenderOptions o;
+		o.address = options.address;
+		o.port = options.port;
+		o.fd = fd;
+		return o;
+	}
+
+public:
+	explicit Recovery(Handler& h, const RecoveryOptions& opts, const std::uint64_t next_sequence = 1)
+	: options(opts)
+	, decoder(h, next_sequence)
+	, replies(replyOptions(opts.packet_size))
+	, requests(requestOptions(opts, replies.fd()))
+	, arena(std::make_unique_for_overwrite<std::uint8_t[]>(opts.max_packets * opts.packet_size))
+	, target(next_sequence)
+	{
+		if (opts.max_packets == 0 || opts.max_packets > std::numeric_limits<std::uint32_t>::max() ||
+		    opts.packet_size < HEADER_SIZE || opts.packet_size > std::numeric_limits<std::uint32_t>::max())
+			throw std::runtime_error("Recovery error: max_packets or packet_size is out of range");
+
+		held.reserve(opts.max_packets);
+		free_slots.reserve(opts.max_packets);
+		for (std::size_t i = opts.max_packets; i-- > 0;) {
+			free_slots.push_back(static_cast<std::uint32_t>(i));
+		}
+	}
+
+	Recovery(const Recovery&) = delete;
+	Recovery& operator=(const Recovery&) = delete;
+	Recovery(const Recovery&&) = delete;
+	Recovery& operator=(const Recovery&&) = delete;
+
+	// Takes one packet of the feed: decodes it if it's next in line (along with any held
+	// packets it unblocks), holds it if it's past a gap, and drops it if it's old.
+	void onPacket(const std::span<const std::uint8_t> payload) {
+		if (payload.size() < HEADER_SIZE) return;
+
+		const PacketView packet(payload.data());
+		if (!has_session) {
+			std::copy_n(packet.session().begin(), SESSION_SIZE, session.begin());
+			has_session = true;
+		} else if (packet.session() != std::string_view(session.data(), SESSION_SIZE)) {
+			return;
+		}
+
+		const std::uint64_t first = packet.sequence();
+		const std::uint16_t count = packet.count();
+
+		if (count == 0 || count == END_OF_SESSION) {
+			extend(first, first);
+			if (count == END_OF_SESSION) session_end = first;
+		} else {
+			extend(first, first + count);
+			if (first > decoder.next_sequence() && payload.size() <= options.packet_size && free_slots.empty()) {
+				++stats_.overflows;
+				abandon();
+			}
+			if (first <= decoder.next_sequence()) {
+				decoder.decode(payload);
+				drain();
+			} else if (payload.size() <= options.packet_size) {
+				hold(payload, first);
+			} // Else it's too long to hold, and will be asked for again.
+		}
+
+		checkOldest();
+	}
+
+	// Takes in retransmissions, and re-requests (or gives up on) gaps that timed out.
+	void poll() {
+		if (!in_gap()) return; // Nothing asked for; late answers are dropped as duplicates.
+		for (const auto packet : replies.receive()) {
+			onPacket(packet);
+		}
+		checkOldest();
+	}
+
+	// Sequence number of the next message to deliver.
+	[[nodiscard]] std::uint64_t next_sequence() const noexcept { return decoder.next_sequence(); }
+
+	// Whether messages are missing before the highest sequence number seen.
+	[[nodiscard]] bool in_gap() const noexcept { return decoder.next_sequence() < target; }
+
+	// Whether the end of session arrived and every message before it was delivered (or
+	// given up on).
+	[[nodiscard]] bool ended() const noexcept { return decoder.next_sequence() >= session_end; }
+
+	[[nodiscard]] const RecoveryStats& stats() const noexcept { return stats_; }
+
+}; // class Recovery
+
+// Receives the feed and recovers gaps until stop is set or the session ends. Returns whether
+// it ended. Give the feed Receiver a short timeout (or busy_poll), since retransmissions are
+// only taken between feed packets.
+template <class Handler, class DispatchPolicy>
+bool run(Receiver& feed, Recovery<Handler, DispatchPolicy>& recovery, const std::atomic<bool>& stop) {
+	while (!stop.load(std::memory_order_relaxed)) {
+		for (const auto packet : feed.receive()) {
+			recovery.onPacket(packet);
+		}
+		recovery.poll();
+		if (recovery.ended()) return true;
+	}
+	return false;
+}
+
+} // namespace itch::mold
+
+#endif // TV_ITCH50_CPP_MOLD_RECOVERY_HPP
@@ -0,0 +1,70 @@
+#ifndef TV_ITCH50_CPP_MOLD_REPLAY_HPP
+#define TV_ITCH50_CPP_MOLD_REPLAY_HPP
+
+#include "itch/mold/packer.hpp"
+#include "itch/mold/sender.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace itch::mold {
+
+struct ReplayOptions {
+	SenderOptions destination;
+	std::string session = "REPLAY0001";
+	std::uint64_t first_sequence = 1;
+	std::size_t max_packet_size = Packer::DEFAULT_MAX_SIZE;
+	std::uint16_t max_messages = END_OF_SESSION - 1;   // Per packet.
+
+	// 0 sends as fast as possible. Otherwise, messages are sent at their timestamp() played
+	// back speed times faster than real time: 1 is real time, 10 is ten times faster.
+	double speed = 0;
+	// When paced, a packet only takes messages up to this long (in feed time) after its
+	// first, so quiet periods aren't held back waiting for a packet to fill.
+	std::uint64_t max_delay_ns = 100'000;
+	// Packets per sendmmsg() when not paced.
+	std::size_t batch = 32;
+	bool end_of_session = true; // Send the end-of-session packet at the end.
+	// If non-zero, every this many data packets one is left unsent, to test gap recovery.
+	std::uint64_t drop_one_in = 0;
+};
+
+struct ReplayStats {
+	std::uint64_t messages = 0;
+	std::uint64_t packets = 0;
+	std::uint64_t bytes = 0;          // UDP payload bytes.
+	double seconds = 0;
+	std::uint64_t max_late_ns = 0;    // When paced: worst delay of a packet past its due time.
+	std::uint64_t dropped = 0;        // Packets left unsent on purpose; see drop_one_in.
+};
+
+// Replays an ITCH file as a MoldUDP64 feed, for testing receivers end to end on one host:
+// messages are read with a Parser, packed with a Packer and sent with a Sender.
+class Replayer {
+
+public:
+	Replayer(const std::string& filepath, ReplayOptions options);
+
+	Replayer(const Replayer&) = delete;
+	Replayer& operator=(const Replayer&) = delete;
+	Replayer(const Replayer&&) = delete;
+	Replayer& operator=(const Replayer&&) = delete;
+
+	// Replays the whole file, or until stop() is called.
+	ReplayStats run();
+
+	// Can be called from any thread; run() returns soon after, without the end of session.
+	void stop() noexcept { stopping.store(true, std::memory_order_relaxed); }
+
+private:
+	const std::string filepath;
+	const ReplayOptions options;
+	std::atomic<bool> stopping = false;
+
+}; // class Replayer
+
+} // namespace itch::mold
+
+#endif // TV_ITCH50_CPP_MOLD_REPLAY_HPP
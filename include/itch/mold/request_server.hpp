@@ -0,0 +1,62 @@
+#ifndef TV_ITCH50_CPP_MOLD_REQUEST_SERVER_HPP
+#define TV_ITCH50_CPP_MOLD_REQUEST_SERVER_HPP
+
+#include "itch/index/index.hpp"
+#include "itch/mmap/mmap.hpp"
+#include "itch/mold/packer.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace itch::mold {
+
+struct RequestServerOptions {
+	std::string address = "127.0.0.1";
+	std::uint16_t port = 0;              // 0 picks a free port; see RequestServer::port().
+	std::string session = "REPLAY0001";  // Requests for other sessions are ignored.
+	std::uint64_t first_sequence = 1;    // Of the first message of the file.
+	std::size_t max_packet_size = Packer::DEFAULT_MAX_SIZE;
+};
+
+// Answers MoldUDP64 re-requests from an ITCH file, as a stand-in for an exchange's
+// retransmission server when testing recovery on one host (see Replayer, which numbers the
+// same file the same way). Messages are found through a MessageIndex with a checkpoint every
+// 1024 messages. POSIX only; the constructor throws on Windows.
+class RequestServer {
+
+public:
+	RequestServer(const std::string& filepath, const RequestServerOptions& options);
+
+	RequestServer(const RequestServer&) = delete;
+	RequestServer& operator=(const RequestServer&) = delete;
+	RequestServer(const RequestServer&&) = delete;
+	RequestServer& operator=(const RequestServer&&) = delete;
+
+	~RequestServer();
+
+	// Answers requests until stop() is called. Returns the number answered.
+	std::uint64_t run();
+
+	// Can be called from any thread; run() returns within 100ms.
+	void stop() noexcept { stopping.store(true, std::memory_order_relaxed); }
+
+	// The bound port, which is useful when RequestServerOptions::port was 0.
+	[[nodiscard]] std::uint16_t port() const noexcept { return port_; }
+
+private:
+	static constexpr std::uint64_t STRIDE = 1024;
+
+	const RequestServerOptions options;
+	const mmap::MemoryMap mapping;
+	const index::MessageIndex messages;
+	int fd_ = -1;
+	std::uint16_t port_ = 0;
+	std::atomic<bool> stopping = false;
+
+}; // class RequestServer
+
+} // namespace itch::mold
+
+#endif // TV_ITCH50_CPP_MOLD_REQUEST_SERVER_HPP
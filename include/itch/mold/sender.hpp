@@ -0,0 +1,56 @@
+#ifndef TV_ITCH50_CPP_MOLD_SENDER_HPP
+#define TV_ITCH50_CPP_MOLD_SENDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace itch::mold {
+
+struct SenderOptions {
+	std::string address = "127.0.0.1";  // Destination, unicast or a multicast group.
+	std::uint16_t port = 0;
+	std::string interface = "0.0.0.0";  // For multicast: the local interface to send from.
+	int ttl = 1;                         // For multicast: 0 keeps packets on this host.
+	int send_buffer = 8 << 20;           // SO_SNDBUF.
+	int fd = -1;                         // Send through this socket (e.g. a Receiver's, so
+	                                     // replies come back to it) rather than a new one.
+};
+
+// A UDP socket that sends whole batches of packets with one sendmmsg() on Linux. POSIX only;
+// the constructor throws on Windows. Multicast is looped back, so receivers on this host see
+// it too.
+class Sender {
+
+public:
+	explicit Sender(const SenderOptions& options);
+
+	Sender(const Sender&) = delete;
+	Sender& operator=(const Sender&) = delete;
+	Sender(const Sender&&) = delete;
+	Sender& operator=(const Sender&&) = delete;
+
+	~Sender();
+
+	void send(std::span<const std::uint8_t> packet);
+
+	// Sends every packet, in order. Throws if the socket fails; a receiver that isn't
+	// keeping up just loses packets, as with any UDP feed.
+	void send(std::span<const std::span<const std::uint8_t>> packets);
+
+	[[nodiscard]] int fd() const noexcept { return fd_; }
+
+private:
+	struct Destination; // Keeps the socket headers out of this one.
+
+	int fd_ = -1;
+	bool is_owned = true;
+	std::unique_ptr<Destination> destination;
+
+}; // class Sender
+
+} // namespace itch::mold
+
+#endif // TV_ITCH50_CPP_MOLD_SENDER_HPP
@@ -0,0 +1,140 @@
+#ifndef TV_ITCH50_CPP_PARALLEL_GZIP_PARSER_HPP
+#define TV_ITCH50_CPP_PARALLEL_GZIP_PARSER_HPP
+
+#include "itch/gzip/gzip.hpp"
+#include "itch/stream/stream.hpp"
+#include "itch/stream_parser.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace itch {
+
+// ParallelParser for .gz files: the uncompressed data is cut at access points of a
+// gzip::GzipIndex (loaded from, or saved to, the "<filepath>.gzidx" sidecar), and every
+// slice is decompressed and parsed by its own thread, with its own Handler, in file order.
+// As with ParallelParser, merging the handlers' results is up to the user.
+template <class Handler>
+class ParallelGzipParser {
+
+private:
+	const std::string filepath;
+	std::span<Handler> handlers;
+	const gzip::GzipIndex idx;
+	std::vector<std::size_t> starts;  // Access point each slice starts from.
+	std::vector<std::uint64_t> cuts;  // handlers.size() + 1 offsets, first is 0, last is size.
+
+	void parse(const std::size_t i) {
+		if (cuts[i] == cuts[i + 1]) return;
+
+		const gzip::AccessPoint& point = idx.points()[starts[i]];
+		gzip::GzipReader gz(filepath, point);
+		gz.skip(cuts[i] - point.out);
+
+		std::uint64_t left = cuts[i + 1] - cuts[i];
+		StreamParser<Handler> parser(
+			[&](std::uint8_t* const buf, const std::size_t size) {
+				const std::size_t n = gz.read(buf, static_cast<std::size_t>(std::min<std::uint64_t>(size, left)));
+				left -= n;
+				return n;
+			},
+			handlers[i]
+		);
+
+		while (parser.next()) {
+			parser.callHandler();
+		}
+	}
+
+public:
+	// One thread is used per handler.
+	explicit ParallelGzipParser(
+		const std::string& path,
+		std::span<Handler> hs,
+		const std::uint64_t span = gzip::GzipIndex::DEFAULT_SPAN
+	)
+	: filepath(path)
+	, handlers(hs)
+	, idx(gzip::GzipIndex::load_or_build(path, span))
+	{
+		// Start every slice from the last point before an even split. With a coarse index,
+		// some slices may end up empty.
+		const auto& points = idx.points();
+		const std::uint64_t size = idx.size();
+		const std::size_t n = handlers.size();
+		starts.reserve(n);
+		cuts.reserve(n + 1);
+		for (std::size_t i = 0; i < n; ++i) {
+			const auto it = std::upper_bound(
+				points.begin(), points.end(), size / n * i,
+				[](const std::uint64_t at, const gzip::AccessPoint& p) { return at < p.out; }
+			);
+			starts.push_back(it == points.begin() ? 0 : static_cast<std::size_t>(it - points.begin() - 1));
+			cuts.push_back(i == 0 || points.empty() ? 0 : points[starts.back()].first_msg);
+		}
+		cuts.push_back(size);
+	}
+
+	ParallelGzipParser(const ParallelGzipParser&) = delete;
+	ParallelGzipParser& operator=(const ParallelGzipParser&) = delete;
+	ParallelGzipParser(const ParallelGzipParser&&) = delete;
+	ParallelGzipParser& operator=(const ParallelGzipParser&&) = delete;
+
+	[[nodiscard]] const gzip::GzipIndex& gzip_index() const noexcept { return idx; }
+
+	// Uncompressed byte range [cuts[i], cuts[i + 1]) is given to handlers[i].
+	[[nodiscard]] const std::vector<std::uint64_t>& chunks() const noexcept { return cuts; }
+
+	// Blocks until every slice is parsed. The calling thread parses the first slice itself.
+	// Rethrows the first error of any slice, e.g. a corrupt file or a stale index whose cuts
+	// don't fall between messages.
+	void run() {
+		std::vector<std::exception_ptr> errors(handlers.size());
+		std::vector<std::thread> threads;
+		threads.reserve(handlers.size());
+
+		const auto guarded = [&](const std::size_t i) {
+			try {
+				parse(i);
+			} catch (...) {
+				errors[i] = std::current_exception();
+			}
+		};
+
+		// A thread that can't be started leaves the ones that were joinable, and destroying
+		// those would terminate the program, so they're joined before rethrowing.
+		try {
+			for (std::size_t i = 1; i < handlers.size(); ++i) {
+				threads.emplace_back(guarded, i);
+			}
+		} catch (...) {
+			for (auto& t : threads) {
+				t.join();
+			}
+			throw;
+		}
+
+		if (!handlers.empty()) {
+			guarded(0);
+		}
+
+		for (auto& t : threads) {
+			t.join();
+		}
+
+		for (const auto& e : errors) {
+			if (e) std::rethrow_exception(e);
+		}
+	}
+
+}; // class ParallelGzipParser
+
+} // namespace itch
+
+#endif // TV_ITCH50_CPP_PARALLEL_GZIP_PARSER_HPP
@@ -0,0 +1,144 @@
+#ifndef TV_ITCH50_CPP_PARALLEL_PARSER_HPP
+#define TV_ITCH50_CPP_PARALLEL_PARSER_HPP
+
+#include "itch/index/index.hpp"
+#include "itch/mmap/mmap.hpp"
+#include "itch/parser.hpp"
+#include "itch/util/util.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace itch {
+
+// Parses one file on several threads. The file is split either at checkpoints of a
+// MessageIndex (loaded from, or saved to, the "<filepath>.idx" sidecar) or, with no index at
+// all, at offsets found by index::resync(). Every chunk is walked by its own thread with its
+// own Handler: handlers[i] sees chunk i, in file order. There is no ordering between chunks,
+// so the handlers must be independent of each other; merging their results after run() is
+// up to the user.
+template <class Handler>
+class ParallelParser {
+
+private:
+	std::span<Handler> handlers;
+	const mmap::MemoryMap mmap;
+	const index::MessageIndex idx;
+	std::vector<std::uint64_t> cuts; // handlers.size() + 1 offsets, first is 0, last is size.
+
+	// Returns where the walk stopped, which is exactly end if the cut at end is right. A
+	// message that would run past end is not dispatched, and stops the walk there.
+	static const std::uint8_t* walk(
+		Handler& h,
+		const std::uint8_t* ptr,
+		const std::uint8_t* const end
+	) noexcept {
+		while (end - ptr > 2) {
+			const auto msg_len = util::read_be<std::uint16_t>(ptr);
+			if (msg_len == 0 || end - ptr - 2 < msg_len) break;
+			dispatch(h, ptr + 2);
+			ptr += 2 + msg_len;
+		}
+		return ptr;
+	}
+
+public:
+	// One thread is used per handler.
+	explicit ParallelParser(
+		const std::string& filepath,
+		std::span<Handler> hs,
+		const std::uint64_t stride = index::MessageIndex::DEFAULT_STRIDE,
+		const index::StrideKind kind = index::MESSAGES
+	)
+	: handlers(hs)
+	, mmap(filepath)
+	, idx(index::MessageIndex::load_or_build(filepath, mmap.data(), mmap.size(), stride, kind))
+	{
+		// Cut as close as the index allows to an even split by bytes. With a coarse index,
+		// some chunks may end up empty.
+		const std::uint64_t size = mmap.size();
+		const std::size_t n = handlers.size();
+		cuts.reserve(n + 1);
+		cuts.push_back(0);
+		for (std::size_t i = 1; i < n; ++i) {
+			cuts.push_back(idx.next_checkpoint(size / n * i));
+		}
+		cuts.push_back(size);
+	}
+
+	// Splits without an index. A false resync (as unlikely as it is) can only be proven by
+	// walking the chunk before it, which run() does too.
+	explicit ParallelParser(const std::string& filepath, std::span<Handler> hs, const index::Resync r)
+	: handlers(hs)
+	, mmap(filepath)
+	, idx()
+	, cuts(index::split(mmap.data(), mmap.size(), hs.empty() ? 1 : hs.size(), r.hops))
+	{/*no-op*/}
+
+	ParallelParser(const ParallelParser&) = delete;
+	ParallelParser& operator=(const ParallelParser&) = delete;
+	ParallelParser(const ParallelParser&&) = delete;
+	ParallelParser& operator=(const ParallelParser&&) = delete;
+
+	// Empty when splitting by resync.
+	[[nodiscard]] const index::MessageIndex& message_index() const noexcept { return idx; }
+
+	// Byte range [cuts[i], cuts[i + 1]) of the file is given to handlers[i].
+	[[nodiscard]] const std::vector<std::uint64_t>& chunks() const noexcept { return cuts; }
+
+	// Blocks until every chunk is parsed. The calling thread parses the first chunk itself.
+	// Throws before dispatching anything if a cut doesn't start a chain of well-formed
+	// messages (see index::is_chain_start). Throws after if a chunk did not end exactly on the
+	// next cut, in which case the handlers of that chunk and the next one have seen
+	// misframed messages; none is read past its chunk.
+	void run() {
+		const std::uint8_t* const base = mmap.data();
+		for (std::size_t i = 1; i < handlers.size(); ++i) {
+			if (cuts[i] != 0 && cuts[i] < mmap.size() && !index::is_chain_start(base, mmap.size(), cuts[i]))
+				throw std::runtime_error("ParallelParser error: cut " + std::to_string(i) +
+				                         " is not on a message boundary");
+		}
+		std::vector<const std::uint8_t*> stops(handlers.size());
+		std::vector<std::thread> threads;
+		threads.reserve(handlers.size());
+
+		// A thread that can't be started leaves the ones that were joinable, and destroying
+		// those would terminate the program, so they're joined before rethrowing.
+		try {
+			for (std::size_t i = 1; i < handlers.size(); ++i) {
+				threads.emplace_back([&, i] {
+					stops[i] = walk(handlers[i], base + cuts[i], base + cuts[i + 1]);
+				});
+			}
+		} catch (...) {
+			for (auto& t : threads) {
+				t.join();
+			}
+			throw;
+		}
+
+		if (!handlers.empty()) {
+			stops[0] = walk(handlers[0], base + cuts[0], base + cuts[1]);
+		}
+
+		for (auto& t : threads) {
+			t.join();
+		}
+
+		for (std::size_t i = 0; i < handlers.size(); ++i) {
+			if (stops[i] != base + cuts[i + 1])
+				throw std::runtime_error("ParallelParser error: chunk " + std::to_string(i) +
+				                         " did not end on its cut");
+		}
+	}
+
+}; // class ParallelParser
+
+} // namespace itch
+
+#endif // TV_ITCH50_CPP_PARALLEL_PARSER_HPP
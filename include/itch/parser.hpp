@@ -1,36 +1,184 @@
 #ifndef TV_ITCH50_CPP_PARSER_HPP
 #define TV_ITCH50_CPP_PARSER_HPP
 
+#include "itch/dispatch.hpp"
 #include "itch/mmap/mmap.hpp"
+#include "itch/mmap/read_ahead.hpp"
 #include "itch/spec/messages.hpp"
 #include "itch/util/util.hpp"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
 
 namespace itch {
 
-template <class Handler>
+// How far ahead of the current message Parser issues prefetches. bytes prefetches every cache
+// line up to that distance ahead; pages prefetches the first line of the page that many pages
+// ahead, which the hardware prefetchers won't do since they stop at page boundaries. Either
+// can be zero, and both zero (the default) turns prefetching off.
+struct PrefetchDistance {
+	std::size_t bytes = 0;
+	std::size_t pages = 0;
+};
+
+// DispatchPolicy decides how callHandler() gets from the type byte to the handler method.
+// See itch/dispatch.hpp for the available policies. The default is the plain switch, timed
+// per message type when built with TV_ITCH50_CPP_INSTRUMENT.
+// With Paged, the parser can also drive a read-ahead thread and slide a windowed mapping
+// (see PagedParser below).
+template <class Handler, class DispatchPolicy = policy::Default, bool Paged = false>
 class Parser {
 
 private:
 	Handler& handler;
-	const mmap::MemoryMap mmap;
+	std::optional<mmap::MemoryMap> mmap; // Only when parsing a file.
+	std::span<const std::uint8_t> view;  // The data, or the part of the file mapped.
+	std::size_t view_offset;             // Offset of view in the file.
 	const std::uint8_t* mmap_ptr;
 	const std::uint8_t* mmap_end;
 	std::uint16_t msg_len;
 	bool is_eof;
 
+	static constexpr std::size_t CACHE_LINE = 64;
+	static constexpr std::size_t PAGE_SIZE = 4096;
+	// With a windowed mapping, the window slides once the parser is this close to its end.
+	// Must be more than twice the longest message.
+	static constexpr std::size_t SLIDE_MARGIN = 4096;
+
+	const PrefetchDistance prefetch_distance;
+	const std::unique_ptr<mmap::ReadAhead> read_ahead;
+	const std::uint8_t* checkpoint; // next() calls onCheckpoint() once mmap_ptr gets here.
+	std::size_t prefetched_bytes = 0;  // Offset up to which lines were prefetched.
+	std::size_t prefetched_page = 0;   // Offset of the last page prefetched.
+	std::size_t published = 0;         // Offset last published to read_ahead.
+
+	// Slides the window (if any), prefetches and publishes to read_ahead, all of which only
+	// need to run once per cache line, page, read-ahead step or window. Out of line so that
+	// next() stays small when all of them are off. Offsets below are in the file.
+	// Unless Paged, this must never call into anything the compiler can't see through:
+	// next() would then have to keep its state in memory rather than registers, which
+	// costs the plain walk about 20%.
+	[[gnu::noinline]] void onCheckpoint() noexcept(!Paged) {
+		if constexpr (Paged) {
+			if (mmap && mmap->is_windowed() && mmap->offset() + mmap->size() < mmap->file_size()
+			    && mmap_ptr >= mmap->data() + mmap->size() - SLIDE_MARGIN) {
+				const std::size_t at = mmap->offset() + static_cast<std::size_t>(mmap_ptr - mmap->data());
+				mmap->slide(at);
+				view = {mmap->data(), mmap->size()};
+				view_offset = mmap->offset();
+				mmap_ptr = view.data() + (at - view_offset);
+				mmap_end = view.data() + view.size();
+			}
+		}
+
+		const std::uint8_t* const base = view.data();
+		const std::size_t first = view_offset;
+		const std::size_t last = first + view.size();
+		const std::size_t pos = first + static_cast<std::size_t>(mmap_ptr - base);
+		std::size_t next_pos = last;
+
+		if (prefetch_distance.bytes != 0) {
+			const std::size_t to = std::min(pos + prefetch_distance.bytes, last);
+			prefetched_bytes = std::max(prefetched_bytes, first);
+			for (; prefetched_bytes < to; prefetched_bytes += CACHE_LINE) {
+				util::prefetch(base + (prefetched_bytes - first));
+			}
+			next_pos = std::min(next_pos, (pos / CACHE_LINE + 1) * CACHE_LINE);
+		}
+
+		if (prefetch_distance.pages != 0) {
+			const std::size_t page = (pos / PAGE_SIZE + prefetch_distance.pages) * PAGE_SIZE;
+			if (page > prefetched_page && page < last) {
+				util::prefetch(base + (page - first));
+				prefetched_page = page;
+			}
+			next_pos = std::min(next_pos, (pos / PAGE_SIZE + 1) * PAGE_SIZE);
+		}
+
+		if constexpr (Paged) {
+			if (mmap && mmap->is_windowed() && last < mmap->file_size()) {
+				next_pos = std::min(next_pos, last - SLIDE_MARGIN);
+			}
+
+			if (read_ahead) {
+				const std::size_t step = read_ahead->step();
+				if (pos >= published + step) {
+					read_ahead->publish(pos);
+					published = pos;
+				}
+				next_pos = std::min(next_pos, published + step);
+			}
+		}
+
+		checkpoint = base + (std::min(next_pos, last) - first);
+	}
+
 public:
-	explicit Parser(const std::string& filepath, Handler& h)
+	// prefetch, read_ahead and the mapping window are all off by default; see
+	// PrefetchDistance, mmap::ReadAheadWindow and mmap::MapOptions. read_ahead and the
+	// window need a PagedParser.
+	explicit Parser(
+		const std::string& filepath,
+		Handler& h,
+		const PrefetchDistance prefetch = {},
+		const mmap::ReadAheadWindow read_ahead_window = {},
+		const mmap::MapOptions map_options = {}
+	)
 	: handler(h)
-	, mmap(filepath)
-	, mmap_ptr(mmap.data())
-	, mmap_end(mmap.data() + mmap.size())
+	, mmap(std::in_place, filepath, map_options)
+	, view(mmap->data(), mmap->size())
+	, view_offset(mmap->offset())
+	, mmap_ptr(view.data())
+	, mmap_end(view.data() + view.size())
 	, msg_len(0)
 	, is_eof(mmap_ptr >= mmap_end)
-	{/*no-op*/}
+	, prefetch_distance(prefetch)
+	, read_ahead(Paged && (read_ahead_window.ahead != 0 || read_ahead_window.drop_behind)
+		? std::make_unique<mmap::ReadAhead>(*mmap, read_ahead_window)
+		: nullptr)
+	, checkpoint(mmap_end) // Never reached, so checkpoints are off unless started below.
+	{
+		if (!Paged && (read_ahead_window.ahead != 0 || read_ahead_window.drop_behind))
+			throw std::runtime_error("Parser error: read-ahead needs a PagedParser");
+		if (!Paged && mmap->is_windowed())
+			throw std::runtime_error("Parser error: a mapping window needs a PagedParser");
+
+		if (!is_eof && (prefetch.bytes != 0 || prefetch.pages != 0 || read_ahead || mmap->is_windowed())) {
+			onCheckpoint();
+		}
+	}
+
+	// Parses data already in memory (shared memory, a capture buffer, a decompressed block,
+	// a test fixture...) in place. data must hold whole messages and outlive the parser.
+	// The mapping file constructor above is this plus a MemoryMap.
+	explicit Parser(
+		const std::span<const std::uint8_t> data,
+		Handler& h,
+		const PrefetchDistance prefetch = {}
+	)
+	: handler(h)
+	, mmap()
+	, view(data)
+	, view_offset(0)
+	, mmap_ptr(view.data())
+	, mmap_end(view.data() + view.size())
+	, msg_len(0)
+	, is_eof(mmap_ptr >= mmap_end)
+	, prefetch_distance(prefetch)
+	, read_ahead(nullptr)
+	, checkpoint(mmap_end)
+	{
+		if (!is_eof && (prefetch.bytes != 0 || prefetch.pages != 0)) {
+			onCheckpoint();
+		}
+	}
 
 	Parser(const Parser&) = delete;
 	Parser& operator=(const Parser&) = delete;
@@ -39,7 +187,8 @@ public:
 
 	[[nodiscard]] bool eof() const noexcept { return is_eof; }
 
-	bool next() noexcept {
+	// A PagedParser can throw here if sliding its window fails.
+	bool next() noexcept(!Paged) {
 		if (!is_eof) {
 			mmap_ptr += msg_len;
 			msg_len = util::read_be<std::uint16_t>(mmap_ptr);
@@ -49,207 +198,52 @@ public:
 				is_eof = true;
 			}
 
+			if (mmap_ptr >= checkpoint) {
+				onCheckpoint();
+			}
+
 			return true;
 		}
 
 		return false;
 	}
 
-	void callHandler() const noexcept {
-		using namespace spec::view;
-
-		const auto curr_msg_type = util::read_be<std::uint8_t>(mmap_ptr);
-		switch (curr_msg_type) {
-			case 'S': {
-				using msgV = SystemEventView;
-				if constexpr (requires (Handler h, msgV v)
-				              {h.onSystemEvent(v);}) {
-					handler.onSystemEvent( msgV{mmap_ptr} );
-				}
-				break;
-			}
-			case 'R': {
-				using msgV = StockDirectoryView;
-				if constexpr (requires (Handler h, msgV v)
-				              {h.onStockDirectory(v);}) {
-					handler.onStockDirectory( msgV{mmap_ptr} );
-				}
-				break;
-			}
-		    case 'H': {
-	            using msgV = StockTradingActionView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onStockTradingAction(v);}) {
-	                handler.onStockTradingAction(msgV{mmap_ptr});
-	            }
-	            break;
-			}
-			case 'Y': {
-	            using msgV = RegSHORestrictionView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onRegSHORestriction(v);}) {
-	                handler.onRegSHORestriction(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-			case 'L': {
-	            using msgV = MarketParticipantPositionView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onMarketParticipantPosition(v);}) {
-	                handler.onMarketParticipantPosition(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-   			case 'V': {
-	            using msgV = MWCBDeclineLevelView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onMWCBDeclineLevel(v);}) {
-	                handler.onMWCBDeclineLevel(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-      		case 'W': {
-	            using msgV = MWCBStatusView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onMWCBStatus(v);}) {
-	                handler.onMWCBStatus(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-        	case 'K': {
-	            using msgV = IPOQuotingPeriodUpdateView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onIPOQuotingPeriodUpdate(v);}) {
-	                handler.onIPOQuotingPeriodUpdate(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-         	case 'J': {
-	            using msgV = LULDAuctionCollarView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onLULDAuctionCollar(v);}) {
-	                handler.onLULDAuctionCollar(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-          	case 'h': {
-	            using msgV = OperationalHaltView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onOperationalHalt(v);}) {
-	                handler.onOperationalHalt(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-
-           	case 'A': {
-	            using msgV = AddOrderView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onAddOrder(v);}) {
-	                handler.onAddOrder(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-            case 'F': {
-	            using msgV = AddOrderWithMPIDView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onAddOrderWithMPID(v);}) {
-	                handler.onAddOrderWithMPID(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-            case 'E': {
-	            using msgV = ExecuteOrderView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onExecuteOrder(v);}) {
-	                handler.onExecuteOrder(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-            case 'C': {
-	            using msgV = ExecuteOrderWithPriceView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onExecuteOrderWithPrice(v);}) {
-	                handler.onExecuteOrderWithPrice(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-            case 'X': {
-	            using msgV = CancelOrderView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onCancelOrder(v);}) {
-	                handler.onCancelOrder(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-            case 'D': {
-	            using msgV = DeleteOrderView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onDeleteOrder(v);}) {
-	                handler.onDeleteOrder(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-            case 'U': {
-	            using msgV = ReplaceOrderView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onReplaceOrder(v);}) {
-	                handler.onReplaceOrder(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-            case 'P': {
-	            using msgV = NonCrossTradeView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onNonCrossTrade(v);}) {
-	                handler.onNonCrossTrade(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-            case 'Q': {
-	            using msgV = CrossTradeView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onCrossTrade(v);}) {
-	                handler.onCrossTrade(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-            case 'B': {
-	            using msgV = BrokenTradeView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onBrokenTrade(v);}) {
-	                handler.onBrokenTrade(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-            case 'I': {
-	            using msgV = NetOrderImbalanceView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onNetOrderImbalance(v);}) {
-	                handler.onNetOrderImbalance(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-            case 'N': {
-	            using msgV = RetailPriceImprovementView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onRetailPriceImprovement(v);}) {
-	                handler.onRetailPriceImprovement(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
-            case 'O': {
-	            using msgV = DLCRPriceDiscoveryView;
-	            if constexpr (requires (Handler h, msgV v)
-							  {h.onDLCRPriceDiscovery(v);}) {
-	                handler.onDLCRPriceDiscovery(msgV{mmap_ptr});
-	            }
-	            break;
-	        }
+	// Advances by up to out.size() messages and stores a pointer to each of them (at the type
+	// byte) in out. Returns how many were stored; zero means EOF. Afterwards, the current
+	// message is the last one stored. See itch/batch.hpp for dispatching a batch.
+	std::size_t nextBatch(std::span<const std::uint8_t*> out) noexcept(!Paged) {
+		std::size_t n = 0;
+		while (n < out.size() && next()) {
+			out[n++] = mmap_ptr;
 		}
+		return n;
+	}
+
+	// The underlying mapping, e.g. to check mapping().effects(). Throws when parsing a span.
+	[[nodiscard]] const mmap::MemoryMap& mapping() const {
+		if (!mmap)
+			throw std::runtime_error("Parser error: parsing a span, there is no mapping");
+		return *mmap;
+	}
+
+	// All of the data being parsed, or the part of the file currently mapped.
+	[[nodiscard]] std::span<const std::uint8_t> data() const noexcept { return view; }
+
+	// Pointer to the current message, at its type byte (the same base the views use).
+	[[nodiscard]] const std::uint8_t* message() const noexcept { return mmap_ptr; }
+
+	void callHandler() const noexcept {
+		policy::dispatch<DispatchPolicy>(handler, mmap_ptr, msg_len);
 	}
 
 }; // class Parser
 
+// Parser that can also drive a read-ahead thread and slide a windowed mapping. It's a separate
+// type because calling into the OS from next(), however rarely, makes the compiler keep the
+// parser's state in memory, which slows the plain Parser down even when both are off.
+template <class Handler, class DispatchPolicy = policy::Default>
+using PagedParser = Parser<Handler, DispatchPolicy, true>;
+
 } // namespace itch
 
 #endif // TV_ITCH50_CPP_PARSER_HPP
@@ -0,0 +1,123 @@
+#ifndef TV_ITCH50_CPP_PCAP_HPP
+#define TV_ITCH50_CPP_PCAP_HPP
+
+#include "itch/mmap/mmap.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace itch::pcap {
+
+// The link layers parse_udp() understands (LINKTYPE_* values).
+enum LinkType : std::uint16_t {
+	LINK_NULL       = 0,    // BSD loopback: a 4-byte address family in the writer's byte order.
+	LINK_ETHERNET   = 1,    // With or without 802.1Q/802.1ad VLAN tags.
+	LINK_RAW        = 101,  // IPv4 or IPv6, told apart by the version nibble.
+	LINK_LINUX_SLL  = 113,  // tcpdump -i any.
+	LINK_IPV4       = 228,
+	LINK_IPV6       = 229,
+	LINK_LINUX_SLL2 = 276
+};
+
+// One captured packet, pointing into the mapped capture.
+struct Frame {
+	std::uint64_t timestamp = 0;       // Capture time in ns since the Unix epoch; 0 if unknown.
+	std::uint16_t link_type = 0;
+	std::uint32_t original_size = 0;   // On the wire; data is shorter if the capture cut it.
+	std::span<const std::uint8_t> data;
+};
+
+// The UDP part of a Frame. Addresses are only filled in for IPv4 (0 for IPv6), in host order.
+struct Datagram {
+	std::uint32_t source = 0;
+	std::uint32_t destination = 0;
+	std::uint16_t source_port = 0;
+	std::uint16_t destination_port = 0;
+	std::span<const std::uint8_t> payload;
+};
+
+// Finds the UDP payload of a frame. False for anything else, including IP fragments and
+// frames the capture cut short.
+[[nodiscard]] bool parse_udp(const Frame& frame, Datagram& datagram) noexcept;
+
+// Reads the packets of a pcap or pcapng capture, in either byte order, without libpcap and
+// without copying: the file is mapped and frames point into it. Nanosecond pcap files and
+// the pcapng if_tsresol and if_tsoffset options are handled, so timestamps always come out in
+// ns. Throws if the file is neither, or a record runs past the end of it.
+class Capture {
+
+public:
+	// Any MapOptions but a window.
+	explicit Capture(const std::string& filepath, const mmap::MapOptions& map_options = {});
+
+	Capture(const Capture&) = delete;
+	Capture& operator=(const Capture&) = delete;
+	Capture(const Capture&&) = delete;
+	Capture& operator=(const Capture&&) = delete;
+
+	// Moves to the next packet; false at the end of the capture.
+	bool next(Frame& frame);
+
+	[[nodiscard]] bool is_pcapng() const noexcept { return is_ng; }
+	[[nodiscard]] const mmap::MemoryMap& mapping() const noexcept { return map; }
+
+private:
+	struct Interface {
+		std::uint16_t link_type = 0;
+		std::uint8_t resolution = 6;   // if_tsresol: 10^-n s, or 2^-n s with the top bit set.
+		std::int64_t offset = 0;       // if_tsoffset, in seconds.
+	};
+
+	const mmap::MemoryMap map;
+	const std::uint8_t* ptr;
+	const std::uint8_t* end;
+	bool is_ng = false;
+	bool is_swapped = false;       // Written in the other byte order.
+	std::vector<Interface> interfaces;  // pcap has exactly one.
+
+	[[nodiscard]] std::uint16_t read16(const std::uint8_t* p) const noexcept;
+	[[nodiscard]] std::uint32_t read32(const std::uint8_t* p) const noexcept;
+
+	bool nextPcap(Frame& frame);
+	bool nextPcapng(Frame& frame);
+	void readInterface(const std::uint8_t* body, std::size_t size);
+
+}; // class Capture
+
+// Writes a pcap capture with nanosecond timestamps, e.g. to turn an ITCH file into a capture
+// of its MoldUDP64 feed for tests and benchmarks.
+class Writer {
+
+public:
+	explicit Writer(const std::string& filepath, LinkType link_type = LINK_ETHERNET, std::uint32_t snap_length = 65535);
+
+	Writer(const Writer&) = delete;
+	Writer& operator=(const Writer&) = delete;
+	Writer(const Writer&&) = delete;
+	Writer& operator=(const Writer&&) = delete;
+
+	// Writes a frame as is.
+	void write(std::uint64_t timestamp, std::span<const std::uint8_t> frame);
+
+	// Wraps the payload in UDP and IPv4 headers, and an Ethernet one for LINK_ETHERNET (with the
+	// multicast MAC of a multicast destination). Only for LINK_ETHERNET, LINK_RAW and LINK_IPV4.
+	void write_udp(std::uint64_t timestamp, const Datagram& datagram);
+
+	// Writes out what's buffered; the destructor does too, but can't report failing.
+	void flush();
+
+private:
+	std::unique_ptr<std::FILE, int (*)(std::FILE*)> file;
+	const LinkType link_type;
+	std::vector<std::uint8_t> frame;
+
+}; // class Writer
+
+} // namespace itch::pcap
+
+#endif // TV_ITCH50_CPP_PCAP_HPP
@@ -0,0 +1,120 @@
+#ifndef TV_ITCH50_CPP_PERF_HPP
+#define TV_ITCH50_CPP_PERF_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Hardware performance counters around a parse, through perf_event_open. Linux only. Counters
+// the CPU, the kernel (kernel.perf_event_paranoid above 2) or a VM doesn't provide are left
+// out and reported as such; the parse runs all the same.
+namespace itch::perf {
+
+enum Event : std::size_t {
+	CYCLES,
+	INSTRUCTIONS,
+	BRANCH_MISSES,
+	L1D_MISSES,     // Level 1 data cache read misses.
+	LLC_MISSES,     // Last level cache read misses.
+	DTLB_MISSES,    // Data TLB read misses.
+	EVENTS
+};
+
+[[nodiscard]] const char* name(Event event) noexcept;
+
+// Counts since Counters::start(), and the time, in ns. When the kernel had to share the
+// hardware between more counters than it has, each count is scaled up from the time it ran.
+struct Reading {
+	std::array<std::uint64_t, EVENTS> counts{};
+	std::uint64_t ns = 0;
+};
+
+[[nodiscard]] Reading operator-(const Reading& after, const Reading& before) noexcept;
+
+// One counter per event, for the calling thread, user space only. Those that can't be opened
+// stay closed and read as 0; available() tells them apart.
+class Counters {
+
+public:
+	Counters();
+
+	Counters(const Counters&) = delete;
+	Counters& operator=(const Counters&) = delete;
+	Counters(const Counters&&) = delete;
+	Counters& operator=(const Counters&&) = delete;
+
+	~Counters();
+
+	[[nodiscard]] bool available(Event event) const noexcept { return fds[event] >= 0; }
+
+	// Why the first counter that couldn't be opened wasn't. Empty if they all were.
+	[[nodiscard]] const std::string& error() const noexcept { return reason; }
+
+	// Resets and starts every available counter.
+	void start() noexcept;
+	void stop() noexcept;
+
+	[[nodiscard]] Reading read() const noexcept;
+
+private:
+	std::array<int, EVENTS> fds;
+	std::string reason;
+	std::chrono::steady_clock::time_point started;
+
+}; // class Counters
+
+struct Interval {
+	std::uint64_t messages = 0;
+	Reading reading;
+};
+
+struct Profile {
+	std::array<bool, EVENTS> available{};
+	std::string error;
+	std::vector<Interval> intervals;   // In the order they were parsed.
+};
+
+// Runs parser to the end, calling the handler on every message, and reads the counters every
+// `every` messages (and after the last; 0 reads them only then), so each interval can be told
+// apart: the start of the day from the open, say. Anything with Parser's next() and
+// callHandler() will do. What is counted is the whole loop on the calling thread, next()
+// included.
+template <class Parser>
+Profile profile(Parser& parser, const std::uint64_t every = 1'000'000) {
+	Counters counters;
+	Profile result;
+	for (std::size_t e = 0; e < EVENTS; ++e) {
+		result.available[e] = counters.available(static_cast<Event>(e));
+	}
+	result.error = counters.error();
+
+	std::uint64_t n = 0;
+	std::uint64_t mark = every;
+	counters.start();
+	Reading last = counters.read();
+	while (parser.next()) {
+		parser.callHandler();
+		if (++n == mark) [[unlikely]] {
+			const Reading now = counters.read();
+			result.intervals.push_back({every, now - last});
+			last = now;
+			mark += every;
+		}
+	}
+	if (n + every != mark) {
+		result.intervals.push_back({n + every - mark, counters.read() - last});
+	}
+	counters.stop();
+	return result;
+}
+
+// A row per interval, then the total: messages, ns, cycles and instructions per message, IPC,
+// and each kind of miss per message. Counters that weren't available show as "-".
+[[nodiscard]] std::string report(const Profile& profile);
+
+} // namespace itch::perf
+
+#endif // TV_ITCH50_CPP_PERF_HPP
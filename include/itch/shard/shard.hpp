@@ -0,0 +1,133 @@
+#ifndef TV_ITCH50_CPP_SHARD_HPP
+#define TV_ITCH50_CPP_SHARD_HPP
+
+#include "itch/parser.hpp"
+#include "itch/shard/spsc_ring.hpp"
+#include "itch/util/util.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace itch::shard {
+
+// Pins a thread to one CPU. Returns false if that's not supported or it failed.
+bool pin_thread(std::thread& t, std::size_t cpu) noexcept;
+
+// Fans messages out to worker threads by stock_locate. The reader thread calls push() with a
+// pointer to each message; the message goes into the ring of shard (stock_locate % N) and
+// that shard's worker calls the matching method of its own Handler. Every message of a given
+// stock_locate goes through the same ring, so per-symbol order is preserved. Messages with
+// stock_locate 0 (not tied to a symbol, e.g. SystemEvent) are broadcast to every shard.
+//
+// Only pointers are passed, so the memory they point to (usually the Parser's mapping) must
+// outlive finish().
+template <class Handler>
+class ShardedDispatcher {
+
+private:
+	using Ring = SpscRing<const std::uint8_t*>;
+
+	std::span<Handler> handlers;
+	std::vector<std::unique_ptr<Ring>> rings;
+	std::vector<std::thread> workers;
+	std::atomic<bool> done{false};
+	bool is_finished = false;
+
+	static void drain(Handler& h, Ring& ring, const std::atomic<bool>& done) noexcept {
+		const std::uint8_t* msg = nullptr;
+		for (;;) {
+			if (ring.try_pop(msg)) {
+				dispatch(h, msg);
+			} else if (done.load(std::memory_order_acquire)) {
+				while (ring.try_pop(msg)) {
+					dispatch(h, msg);
+				}
+				return;
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	static void push_to(Ring& ring, const std::uint8_t* const msg) noexcept {
+		while (!ring.try_push(msg)) {
+			std::this_thread::yield();
+		}
+	}
+
+public:
+	// One worker and one ring per handler. If cpus is non-empty, worker i is pinned to
+	// cpus[i % cpus.size()] (best effort).
+	explicit ShardedDispatcher(
+		std::span<Handler> hs,
+		const std::size_t ring_capacity = 1u << 16,
+		std::span<const std::size_t> cpus = {}
+	)
+	: handlers(hs)
+	{
+		rings.reserve(handlers.size());
+		workers.reserve(handlers.size());
+		for (std::size_t i = 0; i < handlers.size(); ++i) {
+			rings.push_back(std::make_unique<Ring>(ring_capacity));
+		}
+		// The destructor won't run if a thread can't be started, so the ones that were must be
+		// joined here, or their std::thread would terminate the program.
+		try {
+			for (std::size_t i = 0; i < handlers.size(); ++i) {
+				workers.emplace_back(drain, std::ref(handlers[i]), std::ref(*rings[i]), std::cref(done));
+				if (!cpus.empty()) {
+					pin_thread(workers.back(), cpus[i % cpus.size()]);
+				}
+			}
+		} catch (...) {
+			finish();
+			throw;
+		}
+	}
+
+	ShardedDispatcher(const ShardedDispatcher&) = delete;
+	ShardedDispatcher& operator=(const ShardedDispatcher&) = delete;
+	ShardedDispatcher(const ShardedDispatcher&&) = delete;
+	ShardedDispatcher& operator=(const ShardedDispatcher&&) = delete;
+
+	~ShardedDispatcher() { finish(); }
+
+	[[nodiscard]] std::size_t shards() const noexcept { return rings.size(); }
+
+	// Reader thread only. msg must point to the message type byte, like Parser::message().
+	// Blocks (yielding) while the target ring is full.
+	void push(const std::uint8_t* const msg) noexcept {
+		if (rings.empty()) return;
+
+		const auto locate = util::read_be<std::uint16_t>(msg + 1);
+		if (locate != 0) {
+			push_to(*rings[locate % rings.size()], msg);
+		} else {
+			for (auto& ring : rings) {
+				push_to(*ring, msg);
+			}
+		}
+	}
+
+	// Lets the workers drain what's left, then joins them. Handlers are safe to read after.
+	void finish() noexcept {
+		if (is_finished) return;
+		is_finished = true;
+
+		done.store(true, std::memory_order_release);
+		for (auto& w : workers) {
+			w.join();
+		}
+	}
+
+}; // class ShardedDispatcher
+
+} // namespace itch::shard
+
+#endif // TV_ITCH50_CPP_SHARD_HPP
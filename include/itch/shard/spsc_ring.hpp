@@ -0,0 +1,77 @@
+#ifndef TV_ITCH50_CPP_SPSC_RING_HPP
+#define TV_ITCH50_CPP_SPSC_RING_HPP
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace itch::shard {
+
+inline constexpr std::size_t CACHE_LINE = 64;
+
+// Bounded lock-free ring for exactly one producer thread and one consumer thread. The
+// producer and consumer indices live on separate cache lines, and each side keeps a cached
+// copy of the other side's index so that it only touches the shared line when the ring
+// looks full (producer) or empty (consumer).
+template <typename T>
+class SpscRing {
+
+	static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+	// Capacity is rounded up to a power of two.
+	explicit SpscRing(const std::size_t capacity)
+	: mask(std::bit_ceil(capacity < 2 ? 2 : capacity) - 1)
+	, buf(std::make_unique<T[]>(mask + 1))
+	{/*no-op*/}
+
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	[[nodiscard]] std::size_t capacity() const noexcept { return mask + 1; }
+
+	// Producer side only.
+	bool try_push(const T& value) noexcept {
+		const std::size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head_cache > mask) {
+			head_cache = head.load(std::memory_order_acquire);
+			if (t - head_cache > mask)
+				return false;
+		}
+		buf[t & mask] = value;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side only.
+	bool try_pop(T& value) noexcept {
+		const std::size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail_cache) {
+			tail_cache = tail.load(std::memory_order_acquire);
+			if (h == tail_cache)
+				return false;
+		}
+		value = buf[h & mask];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	const std::size_t mask;
+	const std::unique_ptr<T[]> buf;
+
+	alignas(CACHE_LINE) std::atomic<std::size_t> head{0}; // Written by the consumer.
+	std::size_t tail_cache = 0;                           // Consumer's copy of tail.
+
+	alignas(CACHE_LINE) std::atomic<std::size_t> tail{0}; // Written by the producer.
+	std::size_t head_cache = 0;                           // Producer's copy of head.
+
+	char padding[CACHE_LINE - sizeof(std::atomic<std::size_t>) - sizeof(std::size_t)];
+
+}; // class SpscRing
+
+} // namespace itch::shard
+
+#endif // TV_ITCH50_CPP_SPSC_RING_HPP
@@ -0,0 +1,403 @@
+#ifndef TV_ITCH50_CPP_ENCODE_HPP
+#define TV_ITCH50_CPP_ENCODE_HPP
+
+#include "itch/spec/messages.hpp"
+#include "itch/util/util.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// The inverse of unbox(): writes a message struct in wire format, big-endian, with its 2-byte
+// length field in front, as it would appear in an ITCH file. Nothing is checked or allocated;
+// out must hold ENCODED_SIZE<T> bytes (MAX_ENCODED_SIZE holds any message).
+namespace itch::spec {
+
+// Message type byte by message struct.
+template <typename T>
+inline constexpr std::uint8_t MESSAGE_TYPE = 0;
+
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<SystemEvent> = 'S';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<StockDirectory> = 'R';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<StockTradingAction> = 'H';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<RegSHORestriction> = 'Y';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<MarketParticipantPosition> = 'L';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<MWCBDeclineLevel> = 'V';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<MWCBStatus> = 'W';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<IPOQuotingPeriodUpdate> = 'K';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<LULDAuctionCollar> = 'J';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<OperationalHalt> = 'h';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<AddOrder> = 'A';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<AddOrderWithMPID> = 'F';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<ExecuteOrder> = 'E';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<ExecuteOrderWithPrice> = 'C';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<CancelOrder> = 'X';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<DeleteOrder> = 'D';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<ReplaceOrder> = 'U';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<NonCrossTrade> = 'P';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<CrossTrade> = 'Q';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<BrokenTrade> = 'B';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<NetOrderImbalance> = 'I';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<RetailPriceImprovement> = 'N';
+template <> inline constexpr std::uint8_t MESSAGE_TYPE<DLCRPriceDiscovery> = 'O';
+
+// Bytes written by encode(), length field included.
+template <typename T>
+inline constexpr std::size_t ENCODED_SIZE = 2 + MESSAGE_LENGTH[MESSAGE_TYPE<T>];
+
+inline constexpr std::size_t MAX_ENCODED_SIZE = 2 + 50; // NetOrderImbalance
+
+inline std::size_t encode(const SystemEvent& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<SystemEvent>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<SystemEvent>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.event_code);
+	return size;
+}
+
+inline std::size_t encode(const StockDirectory& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<StockDirectory>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<StockDirectory>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.stock);
+	util::write_be(base + 19, msg.market_category);
+	util::write_be(base + 20, msg.financial_status);
+	util::write_be(base + 21, msg.round_lot_size);
+	util::write_be(base + 25, msg.is_round_lots_only);
+	util::write_be(base + 26, msg.issue_classification);
+	util::write_be(base + 27, msg.issue_subtype);
+	util::write_be(base + 29, msg.authenticity);
+	util::write_be(base + 30, msg.short_sale_threshold);
+	util::write_be(base + 31, msg.is_ipo);
+	util::write_be(base + 32, msg.luld_ref_price_tier);
+	util::write_be(base + 33, msg.is_etp);
+	util::write_be(base + 34, msg.etp_leverage_factor);
+	util::write_be(base + 38, msg.is_inverse_etp);
+	return size;
+}
+
+inline std::size_t encode(const StockTradingAction& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<StockTradingAction>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<StockTradingAction>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.stock);
+	util::write_be(base + 19, msg.trading_state);
+	util::write_be(base + 20, msg.reserved);
+	util::write_be(base + 21, msg.trading_action_reason);
+	return size;
+}
+
+inline std::size_t encode(const RegSHORestriction& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<RegSHORestriction>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<RegSHORestriction>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.stock);
+	util::write_be(base + 19, msg.reg_sho_action);
+	return size;
+}
+
+inline std::size_t encode(const MarketParticipantPosition& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<MarketParticipantPosition>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<MarketParticipantPosition>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.mp_id);
+	util::write_be(base + 15, msg.stock);
+	util::write_be(base + 23, msg.is_primary_market_maker);
+	util::write_be(base + 24, msg.market_maker_mode);
+	util::write_be(base + 25, msg.market_participant_state);
+	return size;
+}
+
+inline std::size_t encode(const MWCBDeclineLevel& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<MWCBDeclineLevel>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<MWCBDeclineLevel>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.price_level1);
+	util::write_be(base + 19, msg.price_level2);
+	util::write_be(base + 27, msg.price_level3);
+	return size;
+}
+
+inline std::size_t encode(const MWCBStatus& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<MWCBStatus>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<MWCBStatus>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.breached_level);
+	return size;
+}
+
+inline std::size_t encode(const IPOQuotingPeriodUpdate& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<IPOQuotingPeriodUpdate>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<IPOQuotingPeriodUpdate>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.stock);
+	util::write_be(base + 19, msg.ipo_quotation_time);
+	util::write_be(base + 23, msg.ipo_quotation_release_flag);
+	util::write_be(base + 24, msg.ipo_price);
+	return size;
+}
+
+inline std::size_t encode(const LULDAuctionCollar& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<LULDAuctionCollar>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<LULDAuctionCollar>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.stock);
+	util::write_be(base + 19, msg.reference_price);
+	util::write_be(base + 23, msg.lower_price);
+	util::write_be(base + 27, msg.upper_price);
+	util::write_be(base + 31, msg.number_of_extensions);
+	return size;
+}
+
+inline std::size_t encode(const OperationalHalt& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<OperationalHalt>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<OperationalHalt>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.stock);
+	util::write_be(base + 19, msg.market_code);
+	util::write_be(base + 20, msg.operational_halt_action);
+	return size;
+}
+
+inline std::size_t encode(const AddOrder& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<AddOrder>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<AddOrder>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.order_id);
+	util::write_be(base + 19, msg.side);
+	util::write_be(base + 20, msg.shares);
+	util::write_be(base + 24, msg.stock);
+	util::write_be(base + 32, msg.price);
+	return size;
+}
+
+inline std::size_t encode(const AddOrderWithMPID& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<AddOrderWithMPID>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<AddOrderWithMPID>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.order_id);
+	util::write_be(base + 19, msg.side);
+	util::write_be(base + 20, msg.shares);
+	util::write_be(base + 24, msg.stock);
+	util::write_be(base + 32, msg.price);
+	util::write_be(base + 36, msg.mp_id);
+	return size;
+}
+
+inline std::size_t encode(const ExecuteOrder& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<ExecuteOrder>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<ExecuteOrder>; // executed_price is not on the wire.
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.order_id);
+	util::write_be(base + 19, msg.executed_shares);
+	util::write_be(base + 23, msg.match_number);
+	return size;
+}
+
+inline std::size_t encode(const ExecuteOrderWithPrice& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<ExecuteOrderWithPrice>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<ExecuteOrderWithPrice>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.order_id);
+	util::write_be(base + 19, msg.executed_shares);
+	util::write_be(base + 23, msg.match_number);
+	util::write_be(base + 31, msg.is_printable);
+	util::write_be(base + 32, msg.executed_price);
+	return size;
+}
+
+inline std::size_t encode(const CancelOrder& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<CancelOrder>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<CancelOrder>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.order_id);
+	util::write_be(base + 19, msg.cancelled_shares);
+	return size;
+}
+
+inline std::size_t encode(const DeleteOrder& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<DeleteOrder>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<DeleteOrder>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.order_id);
+	return size;
+}
+
+inline std::size_t encode(const ReplaceOrder& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<ReplaceOrder>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<ReplaceOrder>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.order_id_old);
+	util::write_be(base + 19, msg.order_id_new);
+	util::write_be(base + 27, msg.shares);
+	util::write_be(base + 31, msg.price);
+	return size;
+}
+
+inline std::size_t encode(const NonCrossTrade& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<NonCrossTrade>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<NonCrossTrade>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.order_id);
+	util::write_be(base + 19, msg.side);
+	util::write_be(base + 20, msg.shares);
+	util::write_be(base + 24, msg.stock);
+	util::write_be(base + 32, msg.price);
+	util::write_be(base + 36, msg.match_number);
+	return size;
+}
+
+inline std::size_t encode(const CrossTrade& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<CrossTrade>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<CrossTrade>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.shares);
+	util::write_be(base + 19, msg.stock);
+	util::write_be(base + 27, msg.price);
+	util::write_be(base + 31, msg.match_number);
+	util::write_be(base + 39, msg.cross_type);
+	return size;
+}
+
+inline std::size_t encode(const BrokenTrade& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<BrokenTrade>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<BrokenTrade>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.match_number);
+	return size;
+}
+
+inline std::size_t encode(const NetOrderImbalance& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<NetOrderImbalance>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<NetOrderImbalance>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.paired_shares);
+	util::write_be(base + 19, msg.imbalance_shares);
+	util::write_be(base + 27, msg.imbalance_direction);
+	util::write_be(base + 28, msg.stock);
+	util::write_be(base + 36, msg.far_price);
+	util::write_be(base + 40, msg.near_price);
+	util::write_be(base + 44, msg.reference_price);
+	util::write_be(base + 48, msg.cross_type);
+	util::write_be(base + 49, msg.price_variation_indicator);
+	return size;
+}
+
+inline std::size_t encode(const RetailPriceImprovement& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<RetailPriceImprovement>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<RetailPriceImprovement>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.stock);
+	util::write_be(base + 19, msg.interest_flag);
+	return size;
+}
+
+inline std::size_t encode(const DLCRPriceDiscovery& msg, std::uint8_t* const out) noexcept {
+	constexpr std::size_t size = ENCODED_SIZE<DLCRPriceDiscovery>;
+	util::write_be<std::uint16_t>(out, size - 2);
+	std::uint8_t* const base = out + 2;
+	base[0] = MESSAGE_TYPE<DLCRPriceDiscovery>;
+	util::write_be(base + 1, msg.stock_locate);
+	util::write_be(base + 3, msg.tracking_number);
+	util::write_be_u48(base + 5, msg.timestamp);
+	util::write_be(base + 11, msg.stock);
+	util::write_be(base + 19, msg.is_eligible_for_trading_release);
+	util::write_be(base + 20, msg.min_allowed_price);
+	util::write_be(base + 24, msg.max_allowed_price);
+	util::write_be(base + 28, msg.near_execution_price);
+	util::write_be(base + 32, msg.near_execution_time);
+	util::write_be(base + 40, msg.lower_price_range_collar);
+	util::write_be(base + 44, msg.upper_price_range_collar);
+	return size;
+}
+
+} // namespace itch::spec
+
+#endif // TV_ITCH50_CPP_ENCODE_HPP
@@ -3,6 +3,7 @@
 
 #include "itch/util/util.hpp"
 
+#include <array>
 #include <cstdint>
 #include <type_traits>
 
@@ -267,6 +268,36 @@ static_assert(std::is_aggregate_v<NetOrderImbalance>);
 static_assert(std::is_aggregate_v<RetailPriceImprovement>);
 static_assert(std::is_aggregate_v<DLCRPriceDiscovery>);
 
+// Message length by message type, as given by the spec: the value of the 2-byte length field,
+// which counts the message type byte but not itself. Zero for bytes that are not a type.
+inline constexpr std::array<std::uint16_t, 256> MESSAGE_LENGTH = [] {
+	std::array<std::uint16_t, 256> len{};
+	len['S'] = 12; // SystemEvent
+	len['R'] = 39; // StockDirectory
+	len['H'] = 25; // StockTradingAction
+	len['Y'] = 20; // RegSHORestriction
+	len['L'] = 26; // MarketParticipantPosition
+	len['V'] = 35; // MWCBDeclineLevel
+	len['W'] = 12; // MWCBStatus
+	len['K'] = 28; // IPOQuotingPeriodUpdate
+	len['J'] = 35; // LULDAuctionCollar
+	len['h'] = 21; // OperationalHalt
+	len['A'] = 36; // AddOrder
+	len['F'] = 40; // AddOrderWithMPID
+	len['E'] = 31; // ExecuteOrder
+	len['C'] = 36; // ExecuteOrderWithPrice
+	len['X'] = 23; // CancelOrder
+	len['D'] = 19; // DeleteOrder
+	len['U'] = 35; // ReplaceOrder
+	len['P'] = 44; // NonCrossTrade
+	len['Q'] = 40; // CrossTrade
+	len['B'] = 19; // BrokenTrade
+	len['I'] = 50; // NetOrderImbalance
+	len['N'] = 20; // RetailPriceImprovement
+	len['O'] = 48; // DLCRPriceDiscovery
+	return len;
+}();
+
 } // namespace itch::spec
 
 // Note: internal pointers always point to the zero'th byte (the message type) to match
@@ -884,8 +915,9 @@ struct ExecuteOrderView {
             order_id(),
             match_number(),
             executed_shares(),
+            0, // executed_price is not on the wire.
             stock_locate(),
-            tracking_number(),
+            tracking_number()
         };
     }
 
@@ -0,0 +1,210 @@
+#ifndef TV_ITCH50_CPP_ORDER_STORE_HPP
+#define TV_ITCH50_CPP_ORDER_STORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace itch::spec {
+
+// Map of order_id -> T, exploiting that ITCH order ids are handed out nearly sequentially
+// through the day. Ids are split in chunks of CHUNK_SIZE consecutive ids, and each chunk is a
+// dense array indexed by (order_id - chunk start), so a lookup is a shift, a mask and two
+// loads, with no hashing or probing. A chunk is recycled as soon as every order in it is
+// dead (which, for all but a few long-lived orders, is shortly after the ids move past it),
+// so memory follows the number of live orders rather than the number of ids seen.
+//
+// Ids that don't fit the window (below the oldest chunk, or absurdly far ahead of the newest)
+// go to a std::unordered_map instead. On a real feed this is a handful of orders.
+template <typename T>
+class OrderStore {
+
+	static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+	static constexpr std::size_t CHUNK_BITS = 16;
+	static constexpr std::size_t CHUNK_SIZE = std::size_t{1} << CHUNK_BITS;
+	// Ids more than this many chunks past the newest chunk are treated as outliers.
+	static constexpr std::size_t MAX_GAP_CHUNKS = 1024;
+	// Retired chunks kept for reuse; any beyond this are freed.
+	static constexpr std::size_t MAX_SPARE_CHUNKS = 4;
+
+	OrderStore() = default;
+	OrderStore(const OrderStore&) = delete;
+	OrderStore& operator=(const OrderStore&) = delete;
+
+	// Returns nullptr if the order isn't live.
+	[[nodiscard]] T* find(const std::uint64_t order_id) noexcept {
+		const std::uint64_t rel = order_id - base;
+		if (order_id >= base && (rel >> CHUNK_BITS) < chunks.size()) {
+			Chunk* const c = chunks[rel >> CHUNK_BITS].get();
+			const std::size_t i = rel & (CHUNK_SIZE - 1);
+			if (c && c->has(i)) return &c->values[i];
+			return nullptr;
+		}
+		return find_outlier(order_id);
+	}
+
+	[[nodiscard]] const T* find(const std::uint64_t order_id) const noexcept {
+		return const_cast<OrderStore*>(this)->find(order_id);
+	}
+
+	// Inserts or overwrites.
+	void insert(const std::uint64_t order_id, const T& value) {
+		if (chunks.empty() && outliers.empty()) {
+			base = order_id & ~std::uint64_t{CHUNK_SIZE - 1};
+		}
+
+		const std::uint64_t rel = order_id - base;
+		if (order_id < base || (rel >> CHUNK_BITS) >= chunks.size() + MAX_GAP_CHUNKS) {
+			outliers[order_id] = value;
+			return;
+		}
+
+		const std::size_t ci = rel >> CHUNK_BITS;
+		if (ci < chunks.size()) {
+			// An id the window covers is never in outliers after this.
+			if (!outliers.empty()) outliers.erase(order_id);
+			place(ci, rel & (CHUNK_SIZE - 1), value);
+			return;
+		}
+
+		const std::size_t newest = chunks.size();
+		chunks.resize(ci + 1);
+		place(ci, rel & (CHUNK_SIZE - 1), value);
+		adopt_outliers();
+
+		// The previous newest chunk is no longer being filled, and erase() only retires
+		// chunks that aren't the newest, so if it's empty it has to go now.
+		if (newest != 0 && chunks[newest - 1] && chunks[newest - 1]->live == 0) {
+			retire(newest - 1);
+		}
+	}
+
+	// Returns false if the order wasn't live.
+	bool erase(const std::uint64_t order_id) {
+		const std::uint64_t rel = order_id - base;
+		if (order_id >= base && (rel >> CHUNK_BITS) < chunks.size()) {
+			const std::size_t ci = rel >> CHUNK_BITS;
+			Chunk* const c = chunks[ci].get();
+			const std::size_t i = rel & (CHUNK_SIZE - 1);
+			if (!c || !c->has(i)) return false;
+
+			c->clear(i);
+			--count;
+			if (--c->live == 0 && ci + 1 < chunks.size()) {
+				retire(ci);
+			}
+			return true;
+		}
+
+		return outliers.erase(order_id) != 0;
+	}
+
+	[[nodiscard]] std::size_t size() const noexcept { return count + outliers.size(); }
+	[[nodiscard]] std::size_t outlier_count() const noexcept { return outliers.size(); }
+
+	// Chunks currently holding live orders, and the bytes they take.
+	[[nodiscard]] std::size_t chunk_count() const noexcept { return allocated - spare.size(); }
+	[[nodiscard]] std::size_t chunk_bytes() const noexcept { return chunk_count() * sizeof(Chunk); }
+
+private:
+	struct Chunk {
+		T values[CHUNK_SIZE];
+		std::uint64_t present[CHUNK_SIZE / 64];
+		std::size_t live;
+
+		[[nodiscard]] bool has(const std::size_t i) const noexcept {
+			return (present[i >> 6] >> (i & 63)) & 1;
+		}
+		void set(const std::size_t i) noexcept { present[i >> 6] |= std::uint64_t{1} << (i & 63); }
+		void clear(const std::size_t i) noexcept { present[i >> 6] &= ~(std::uint64_t{1} << (i & 63)); }
+	};
+
+	std::uint64_t base = 0;                     // First id of chunks[0].
+	std::vector<std::unique_ptr<Chunk>> chunks; // Null where a chunk was retired.
+	std::vector<std::unique_ptr<Chunk>> spare;  // Retired chunks, ready for reuse.
+	std::unordered_map<std::uint64_t, T> outliers;
+	std::size_t count = 0;                      // Live orders in chunks.
+	std::size_t allocated = 0;
+
+	std::unique_ptr<Chunk> acquire() {
+		std::unique_ptr<Chunk> c;
+		if (!spare.empty()) {
+			c = std::move(spare.back());
+			spare.pop_back();
+		} else {
+			c = std::make_unique<Chunk>();
+			++allocated;
+		}
+		for (auto& word : c->present) word = 0;
+		c->live = 0;
+		return c;
+	}
+
+	void place(const std::size_t ci, const std::size_t i, const T& value) {
+		if (!chunks[ci]) {
+			chunks[ci] = acquire();
+		}
+
+		Chunk& c = *chunks[ci];
+		if (!c.has(i)) {
+			c.set(i);
+			++c.live;
+			++count;
+		}
+		c.values[i] = value;
+	}
+
+	// Moves the outliers the window has grown to cover into their chunks, since find() and
+	// erase() only look in the chunk for those ids. Only ids ahead of the window can be
+	// caught up with, as the base never goes back.
+	void adopt_outliers() {
+		if (outliers.empty()) return;
+		const std::uint64_t end = base + (static_cast<std::uint64_t>(chunks.size()) << CHUNK_BITS);
+		for (auto it = outliers.begin(); it != outliers.end();) {
+			if (it->first >= base && it->first < end) {
+				const std::uint64_t rel = it->first - base;
+				place(rel >> CHUNK_BITS, rel & (CHUNK_SIZE - 1), it->second);
+				it = outliers.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+
+	// The newest chunk is never retired since it's still being filled.
+	void retire(const std::size_t ci) {
+		if (spare.size() < MAX_SPARE_CHUNKS) {
+			spare.push_back(std::move(chunks[ci]));
+		} else {
+			chunks[ci].reset();
+			--allocated;
+		}
+
+		// Slide the window past retired chunks at the front. Ids below the new base are
+		// rare from then on and go to the outlier map.
+		std::size_t dead = 0;
+		while (dead + 1 < chunks.size() && !chunks[dead]) {
+			++dead;
+		}
+		if (dead != 0) {
+			chunks.erase(chunks.begin(), chunks.begin() + static_cast<std::ptrdiff_t>(dead));
+			base += static_cast<std::uint64_t>(dead) << CHUNK_BITS;
+		}
+	}
+
+	T* find_outlier(const std::uint64_t order_id) noexcept {
+		if (outliers.empty()) return nullptr;
+		const auto it = outliers.find(order_id);
+		return it == outliers.end() ? nullptr : &it->second;
+	}
+
+}; // class OrderStore
+
+} // namespace itch::spec
+
+#endif // TV_ITCH50_CPP_ORDER_STORE_HPP
@@ -0,0 +1,44 @@
+#ifndef TV_ITCH50_CPP_FD_READER_HPP
+#define TV_ITCH50_CPP_FD_READER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace itch::stream {
+
+// Reads a file descriptor with plain read(): a pipe, stdin, a FIFO, a socket, or a regular
+// file that can't (or shouldn't) be mapped. Meant to be the read function of a BlockStream
+// (or StreamParser), e.g.
+//     [&in](std::uint8_t* buf, std::size_t size) { return in.read(buf, size); }
+class FdReader {
+
+public:
+	// Opens path for reading; "-" is stdin.
+	explicit FdReader(const std::string& path);
+
+	// Reads fd, which is left open afterwards.
+	explicit FdReader(int fd);
+
+	FdReader(const FdReader&) = delete;
+	FdReader& operator=(const FdReader&) = delete;
+	FdReader(const FdReader&&) = delete;
+	FdReader& operator=(const FdReader&&) = delete;
+
+	~FdReader();
+
+	// Reads up to size bytes into buf and returns how many; 0 means the end. Retries when
+	// interrupted by a signal, throws on errors.
+	std::size_t read(std::uint8_t* buf, std::size_t size);
+
+	[[nodiscard]] int fd() const noexcept { return fd_; }
+
+private:
+	int fd_;
+	bool is_owned;
+
+}; // class FdReader
+
+} // namespace itch::stream
+
+#endif // TV_ITCH50_CPP_FD_READER_HPP
@@ -0,0 +1,88 @@
+#ifndef TV_ITCH50_CPP_STREAM_HPP
+#define TV_ITCH50_CPP_STREAM_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace itch::stream {
+
+// Fills buf with up to size bytes of the input and returns how many it wrote; 0 means the
+// input is over. It may return less than size before then. Errors are thrown.
+using ReadFn = std::function<std::size_t(std::uint8_t* buf, std::size_t size)>;
+
+// Turns any byte stream (a pipe, a decompressor, ...) into blocks of whole messages. A reader
+// thread calls read into a ring of large buffers, finds the last whole message in each, and
+// copies the unfinished one (the carry, under 64 KB, in practice a few bytes) into the
+// headroom in front of the next buffer, so every block handed out is contiguous. That is
+// the only copy; everything else is parsed where read put it. Data in each buffer starts
+// on a 4 KB boundary.
+class BlockStream {
+
+public:
+	// Small enough that the blocks in flight stay in cache, so the parser reads what the
+	// reader just wrote from there rather than from memory.
+	static constexpr std::size_t DEFAULT_BLOCK_SIZE = 1u << 20;
+	static constexpr std::size_t DEFAULT_BLOCK_COUNT = 4;
+
+	explicit BlockStream(
+		ReadFn read,
+		std::size_t block_size = DEFAULT_BLOCK_SIZE,
+		std::size_t block_count = DEFAULT_BLOCK_COUNT
+	);
+
+	BlockStream(const BlockStream&) = delete;
+	BlockStream& operator=(const BlockStream&) = delete;
+	BlockStream(const BlockStream&&) = delete;
+	BlockStream& operator=(const BlockStream&&) = delete;
+
+	// Waits for the reader thread, which may be blocked on read until the input ends.
+	~BlockStream();
+
+	// Next block of whole messages, each with its length field, or an empty span once the
+	// input is over. The previous block is handed back to the reader, so pointers into it are
+	// invalid from then on. Rethrows what read threw, and throws if the input ends in the
+	// middle of a message.
+	std::span<const std::uint8_t> next();
+
+private:
+	// Enough for the largest message a 16-bit length allows, rounded up to whole pages.
+	static constexpr std::size_t HEADROOM = 68u << 10;
+
+	struct Block {
+		std::unique_ptr<std::uint8_t[]> memory;
+		std::uint8_t* data = nullptr; // At least HEADROOM bytes into memory, 4 KB aligned.
+		std::size_t carry = 0;        // Bytes copied in front of data.
+		std::size_t size = 0;         // Bytes of whole messages from data - carry.
+	};
+
+	ReadFn read;
+	const std::size_t block_size;
+	std::vector<Block> blocks;
+
+	std::mutex mutex;
+	std::condition_variable filled_cv;
+	std::condition_variable freed_cv;
+	std::uint64_t filled = 0;    // Blocks ready for next().
+	std::uint64_t released = 0;  // Blocks next() is done with.
+	std::uint64_t taken = 0;     // Blocks next() has handed out.
+	bool is_done = false;        // The reader produced its last block.
+	bool stopping = false;
+	std::exception_ptr error;
+
+	std::thread reader;
+
+	void run() noexcept;
+
+}; // class BlockStream
+
+} // namespace itch::stream
+
+#endif // TV_ITCH50_CPP_STREAM_HPP
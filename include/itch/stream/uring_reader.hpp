@@ -0,0 +1,50 @@
+#ifndef TV_ITCH50_CPP_URING_READER_HPP
+#define TV_ITCH50_CPP_URING_READER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace itch::stream {
+
+struct UringOptions {
+	unsigned queue_depth = 32;          // Reads kept in flight.
+	std::size_t chunk_size = 256u << 10; // Bytes per read; a multiple of 4 KB.
+	bool direct = true;                 // O_DIRECT, so the page cache is bypassed.
+};
+
+// Reads a file through io_uring, keeping queue_depth reads of chunk_size in flight into
+// buffers registered with the kernel, so a cold file streams at the device's speed rather
+// than one page fault at a time. Linux only; the constructor throws elsewhere, or if the
+// kernel (or a seccomp policy) refuses io_uring. Meant to be the read function of a
+// BlockStream (or StreamParser), like FdReader.
+class UringReader {
+
+public:
+	explicit UringReader(const std::string& path, UringOptions options = {});
+
+	UringReader(const UringReader&) = delete;
+	UringReader& operator=(const UringReader&) = delete;
+	UringReader(const UringReader&&) = delete;
+	UringReader& operator=(const UringReader&&) = delete;
+
+	~UringReader();
+
+	// Copies up to size bytes into buf and returns how many; 0 means the end. Waits for
+	// reads still in flight, throws if one failed.
+	std::size_t read(std::uint8_t* buf, std::size_t size);
+
+	// Whether the buffers could be registered with the kernel. Registering needs locked
+	// memory, which RLIMIT_MEMLOCK may not allow; reads then go through plain buffers.
+	[[nodiscard]] bool is_registered() const noexcept;
+
+private:
+	struct State; // Keeps the Linux headers out of this one.
+	std::unique_ptr<State> state;
+
+}; // class UringReader
+
+} // namespace itch::stream
+
+#endif // TV_ITCH50_CPP_URING_READER_HPP
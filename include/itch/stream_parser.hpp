@@ -0,0 +1,90 @@
+#ifndef TV_ITCH50_CPP_STREAM_PARSER_HPP
+#define TV_ITCH50_CPP_STREAM_PARSER_HPP
+
+#include "itch/dispatch.hpp"
+#include "itch/stream/stream.hpp"
+#include "itch/util/util.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+
+namespace itch {
+
+// Same interface as Parser, but over any byte stream rather than a mapped file: messages come
+// in blocks from a stream::BlockStream, which reads on its own thread while this one parses.
+// Unlike Parser, eof() only turns true once next() has returned false, since the end of the
+// input isn't known before the reader gets there. next() throws what read throws.
+template <class Handler, class DispatchPolicy = policy::Default>
+class StreamParser {
+
+private:
+	Handler& handler;
+	stream::BlockStream blocks;
+	const std::uint8_t* ptr = nullptr;
+	const std::uint8_t* end = nullptr;
+	std::uint16_t msg_len = 0;
+	bool is_eof = false;
+
+public:
+	explicit StreamParser(
+		stream::ReadFn read,
+		Handler& h,
+		const std::size_t block_size = stream::BlockStream::DEFAULT_BLOCK_SIZE,
+		const std::size_t block_count = stream::BlockStream::DEFAULT_BLOCK_COUNT
+	)
+	: handler(h)
+	, blocks(std::move(read), block_size, block_count)
+	{/*no-op*/}
+
+	StreamParser(const StreamParser&) = delete;
+	StreamParser& operator=(const StreamParser&) = delete;
+	StreamParser(const StreamParser&&) = delete;
+	StreamParser& operator=(const StreamParser&&) = delete;
+
+	[[nodiscard]] bool eof() const noexcept { return is_eof; }
+
+	bool next() {
+		ptr += msg_len;
+		if (ptr == end) {
+			if (is_eof) return false;
+
+			const std::span<const std::uint8_t> block = blocks.next();
+			if (block.empty()) {
+				is_eof = true;
+				msg_len = 0;
+				return false;
+			}
+			ptr = block.data();
+			end = ptr + block.size();
+		}
+
+		msg_len = util::read_be<std::uint16_t>(ptr);
+		ptr += 2;
+		return true;
+	}
+
+	// Same as Parser::nextBatch(), except that a batch never spans two blocks, so it can come
+	// back short before the end. The pointers are valid until the next call.
+	std::size_t nextBatch(std::span<const std::uint8_t*> out) {
+		std::size_t n = 0;
+		while (n < out.size() && next()) {
+			out[n++] = ptr;
+			if (ptr + msg_len == end) break;
+		}
+		return n;
+	}
+
+	// Pointer to the current message, at its type byte.
+	[[nodiscard]] const std::uint8_t* message() const noexcept { return ptr; }
+
+	void callHandler() const noexcept {
+		policy::dispatch<DispatchPolicy>(handler, ptr, msg_len);
+	}
+
+}; // class StreamParser
+
+} // namespace itch
+
+#endif // TV_ITCH50_CPP_STREAM_PARSER_HPP
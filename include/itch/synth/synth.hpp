@@ -0,0 +1,106 @@
+#ifndef TV_ITCH50_CPP_SYNTH_HPP
+#define TV_ITCH50_CPP_SYNTH_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Synthetic ITCH days, for benchmarks that can't count on a Nasdaq sample. The output depends
+// only on the options: the same seed gives the same bytes on any machine and standard library.
+namespace itch::synth {
+
+// Relative weight of each message type in the body of the day, by type byte. The default
+// averages 30.7 bytes per message, length field included, like the Nasdaq sample of the
+// benchmarks. S and R are never drawn; the day's system events and stock directory are
+// written around the body. Unknown bytes are ignored.
+using Mix = std::array<double, 256>;
+
+[[nodiscard]] Mix default_mix() noexcept;
+
+struct GeneratorOptions {
+	std::uint64_t seed = 20200130;
+	std::uint64_t messages = 10'000'000; // All of them, directory and system events included.
+	std::uint32_t symbols = 8'000;
+	double skew = 1.0;                    // Symbol k (from 1) is drawn in proportion to 1 / k^skew.
+	Mix mix = default_mix();
+};
+
+// Writes a day, message by message: start of messages and system hours, a StockDirectory and
+// a StockTradingAction for every symbol, then the body, with start and end of market hours at
+// 09:30 and 16:00, then end of system hours and messages. Timestamps go evenly from 04:00 to
+// 20:00. Orders are consistent: executions, cancels, deletes and replaces only hit live orders,
+// by no more shares than are left. One drawn for a symbol with no live order becomes an add.
+class Generator {
+
+public:
+	explicit Generator(const GeneratorOptions& options = {});
+
+	Generator(const Generator&) = delete;
+	Generator& operator=(const Generator&) = delete;
+	Generator(const Generator&&) = delete;
+	Generator& operator=(const Generator&&) = delete;
+
+	// Encodes the next message, with its length field, to out, which must hold
+	// spec::MAX_ENCODED_SIZE bytes. Returns its size, or 0 once the day is over.
+	std::size_t next(std::uint8_t* out);
+
+	[[nodiscard]] std::uint64_t written() const noexcept { return count; }
+	[[nodiscard]] std::uint64_t live_orders() const noexcept { return live; }
+
+private:
+	struct Order {
+		std::uint64_t id;
+		std::uint32_t shares;
+		std::uint32_t price;
+		std::uint8_t side;
+	};
+
+	const GeneratorOptions options;
+	std::array<std::uint64_t, 4> state;  // xoshiro256**
+	// Walker's alias method, which draws from a discrete distribution in constant time: pick
+	// a slot, then keep it with probability odds[slot] or take alias[slot].
+	struct Alias {
+		std::vector<double> odds;
+		std::vector<std::uint32_t> alias;
+	};
+
+	Alias symbol_table;
+	Alias type_table;
+	std::vector<std::uint8_t> types;     // Message type by slot of type_table.
+	std::vector<std::uint64_t> names;    // Stock field by symbol.
+	std::vector<std::uint32_t> prices;   // Reference price by symbol.
+	std::vector<std::vector<Order>> books; // Live orders by symbol.
+	std::uint64_t count = 0;
+	std::uint64_t live = 0;
+	const std::uint64_t body_begin;      // Index of the first message after the prologue...
+	const std::uint64_t body_end;        // ...and of the first after the body.
+	const double ns_per_message;
+	std::uint64_t next_order = 1;
+	std::uint64_t next_match = 1;
+	std::uint64_t timestamp = 0;
+	bool is_market_open = false;
+	bool is_market_closed = false;
+
+	std::uint64_t random() noexcept;
+	std::uint32_t below(std::uint32_t n) noexcept; // In [0, n).
+	std::uint32_t draw(const Alias& table) noexcept;
+	std::uint32_t near(std::uint32_t price) noexcept;
+	std::uint32_t lot() noexcept;
+
+	std::size_t prologue(std::uint64_t n, std::uint8_t* out);
+	std::size_t body(std::uint8_t* out);
+	std::size_t add(std::uint32_t sym, bool with_mpid, std::uint8_t* out);
+
+}; // class Generator
+
+// A whole day in memory, for benchmarks.
+[[nodiscard]] std::vector<std::uint8_t> generate(const GeneratorOptions& options = {});
+
+// A whole day to a file. Returns the bytes written.
+std::uint64_t write_file(const std::string& filepath, const GeneratorOptions& options = {});
+
+} // namespace itch::synth
+
+#endif // TV_ITCH50_CPP_SYNTH_HPP
@@ -7,6 +7,10 @@
 #include <cstring>
 #include <type_traits>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 namespace itch::util {
 
 [[nodiscard]] inline std::uint16_t byte_swap_u16(const std::uint16_t value) noexcept {
@@ -71,6 +75,47 @@ template <typename T>
 	return val >> 16;
 }
 
+template <typename T>
+inline void write_be(std::uint8_t* ptr, T val) noexcept {
+	static_assert(std::is_same_v<T, std::uint8_t > ||
+				  std::is_same_v<T, std::uint16_t> ||
+				  std::is_same_v<T, std::uint32_t> ||
+				  std::is_same_v<T, std::uint64_t>);
+
+	if constexpr (std::endian::native == std::endian::little) {
+		if constexpr (sizeof(T) == 2) {
+			val = util::byte_swap_u16(val);
+		} else if constexpr (sizeof(T) == 4) {
+			val = util::byte_swap_u32(val);
+		} else if constexpr (sizeof(T) == 8) {
+			val = util::byte_swap_u64(val);
+		}
+	}
+
+	std::memcpy(ptr, &val, sizeof(T));
+}
+
+// Writes the low 6 bytes of val. Higher bytes are dropped.
+inline void write_be_u48(std::uint8_t* ptr, const std::uint64_t val) noexcept {
+	std::uint64_t shifted = val << 16;
+
+	if constexpr (std::endian::native == std::endian::little) {
+		shifted = util::byte_swap_u64(shifted);
+	}
+
+	std::memcpy(ptr, &shifted, 6);
+}
+
+// Hint to load the cache line holding ptr for reading. Never faults, even past the end of a
+// mapping or on a page that isn't resident (the hint is just dropped).
+inline void prefetch(const void* ptr) noexcept {
+#ifdef _MSC_VER
+	_mm_prefetch(static_cast<const char*>(ptr), _MM_HINT_T0);
+#else
+	__builtin_prefetch(ptr, 0, 3);
+#endif
+}
+
 } // namespace itch::util
 
 #endif // TV_ITCH50_CPP_UTIL_HPP
@@ -0,0 +1,424 @@
+// The benchmark suite, built as tv_itch50_cpp_bench with -DTV_ITCH50_CPP_BUILD_BENCHMARKS=ON
+// (and -DCMAKE_BUILD_TYPE=Release). Prints JSON unless given another --benchmark_format. Flags,
+// besides Google benchmark's:
+//   --itch_file=PATH  Parses this file. Without it, a synthetic day is written once to the
+//                     working directory, so runs on any machine parse the same bytes.
+//   --messages=N      Size of the synthetic day; 10 million by default.
+//
+// walk, dispatch/* and unbox go over the whole file, with its pages cached. decode/* unboxes
+// a buffer of one message type. to_string formats the first million messages with itch::ios.
+// cache/warm and cache/cold walk the file with and without its pages cached; cold drops them
+// before every iteration, and is skipped where that isn't possible.
+
+#include "benchmark/benchmark.h"
+#include "itch/ios/ios.hpp"
+#include "itch/mmap/mmap.hpp"
+#include "itch/parser.hpp"
+#include "itch/spec/messages.hpp"
+#include "itch/synth/synth.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+namespace view = itch::spec::view;
+
+std::string input_path;
+std::uint64_t input_messages = 0;
+std::uint64_t input_bytes = 0;
+
+// Walks and nothing else: with no handler methods, the dispatch compiles away.
+struct HandlerAllUndef {}; // HandlerAllUndef
+
+// Dispatches every message to a method that does nothing.
+struct HandlerAllEmpty {
+
+	void onSystemEvent(const view::SystemEventView) noexcept {}
+	void onStockDirectory(const view::StockDirectoryView) noexcept {}
+	void onStockTradingAction(const view::StockTradingActionView) noexcept {}
+	void onRegSHORestriction(const view::RegSHORestrictionView) noexcept {}
+	void onMarketParticipantPosition(const view::MarketParticipantPositionView) noexcept {}
+	void onMWCBDeclineLevel(const view::MWCBDeclineLevelView) noexcept {}
+	void onMWCBStatus(const view::MWCBStatusView) noexcept {}
+	void onIPOQuotingPeriodUpdate(const view::IPOQuotingPeriodUpdateView) noexcept {}
+	void onLULDAuctionCollar(const view::LULDAuctionCollarView) noexcept {}
+	void onOperationalHalt(const view::OperationalHaltView) noexcept {}
+	void onAddOrder(const view::AddOrderView) noexcept {}
+	void onAddOrderWithMPID(const view::AddOrderWithMPIDView) noexcept {}
+	void onExecuteOrder(const view::ExecuteOrderView) noexcept {}
+	void onExecuteOrderWithPrice(const view::ExecuteOrderWithPriceView) noexcept {}
+	void onCancelOrder(const view::CancelOrderView) noexcept {}
+	void onDeleteOrder(const view::DeleteOrderView) noexcept {}
+	void onReplaceOrder(const view::ReplaceOrderView) noexcept {}
+	void onNonCrossTrade(const view::NonCrossTradeView) noexcept {}
+	void onCrossTrade(const view::CrossTradeView) noexcept {}
+	void onBrokenTrade(const view::BrokenTradeView) noexcept {}
+	void onNetOrderImbalance(const view::NetOrderImbalanceView) noexcept {}
+	void onRetailPriceImprovement(const view::RetailPriceImprovementView) noexcept {}
+	void onDLCRPriceDiscovery(const view::DLCRPriceDiscoveryView) noexcept {}
+
+}; // HandlerAllEmpty
+
+// Unboxes every message.
+struct HandlerAllCopy {
+
+	void onSystemEvent(const view::SystemEventView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onStockDirectory(const view::StockDirectoryView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onStockTradingAction(const view::StockTradingActionView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onRegSHORestriction(const view::RegSHORestrictionView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onMarketParticipantPosition(const view::MarketParticipantPositionView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onMWCBDeclineLevel(const view::MWCBDeclineLevelView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onMWCBStatus(const view::MWCBStatusView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onIPOQuotingPeriodUpdate(const view::IPOQuotingPeriodUpdateView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onLULDAuctionCollar(const view::LULDAuctionCollarView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onOperationalHalt(const view::OperationalHaltView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onAddOrder(const view::AddOrderView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onAddOrderWithMPID(const view::AddOrderWithMPIDView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onExecuteOrder(const view::ExecuteOrderView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onExecuteOrderWithPrice(const view::ExecuteOrderWithPriceView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onCancelOrder(const view::CancelOrderView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onDeleteOrder(const view::DeleteOrderView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onReplaceOrder(const view::ReplaceOrderView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onNonCrossTrade(const view::NonCrossTradeView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onCrossTrade(const view::CrossTradeView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onBrokenTrade(const view::BrokenTradeView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onNetOrderImbalance(const view::NetOrderImbalanceView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onRetailPriceImprovement(const view::RetailPriceImprovementView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+	void onDLCRPriceDiscovery(const view::DLCRPriceDiscoveryView v) noexcept { auto m = v.unbox(); benchmark::DoNotOptimize(m); }
+
+}; // HandlerAllCopy
+
+// Formats every message, and counts the characters.
+struct HandlerToString {
+	std::uint64_t bytes = 0;
+
+	void onSystemEvent(const view::SystemEventView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onStockDirectory(const view::StockDirectoryView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onStockTradingAction(const view::StockTradingActionView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onRegSHORestriction(const view::RegSHORestrictionView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onMarketParticipantPosition(const view::MarketParticipantPositionView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onMWCBDeclineLevel(const view::MWCBDeclineLevelView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onMWCBStatus(const view::MWCBStatusView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onIPOQuotingPeriodUpdate(const view::IPOQuotingPeriodUpdateView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onLULDAuctionCollar(const view::LULDAuctionCollarView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onOperationalHalt(const view::OperationalHaltView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onAddOrder(const view::AddOrderView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onAddOrderWithMPID(const view::AddOrderWithMPIDView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onExecuteOrder(const view::ExecuteOrderView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onExecuteOrderWithPrice(const view::ExecuteOrderWithPriceView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onCancelOrder(const view::CancelOrderView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onDeleteOrder(const view::DeleteOrderView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onReplaceOrder(const view::ReplaceOrderView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onNonCrossTrade(const view::NonCrossTradeView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onCrossTrade(const view::CrossTradeView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onBrokenTrade(const view::BrokenTradeView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onNetOrderImbalance(const view::NetOrderImbalanceView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onRetailPriceImprovement(const view::RetailPriceImprovementView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+	void onDLCRPriceDiscovery(const view::DLCRPriceDiscoveryView v) { bytes += itch::ios::to_string(v.unbox()).size(); }
+
+}; // HandlerToString
+
+// Reads the file once, so its pages are cached.
+void warmCache() {
+	HandlerAllUndef h;
+	itch::Parser<HandlerAllUndef> p(input_path, h);
+	std::uint64_t n = 0;
+	while (p.next()) {
+		++n;
+	}
+	benchmark::DoNotOptimize(n);
+}
+
+void setCounters(benchmark::State& state, const std::uint64_t messages, const std::uint64_t bytes) {
+	const auto total = static_cast<std::int64_t>(state.iterations()) * static_cast<std::int64_t>(messages);
+	state.SetItemsProcessed(total);
+	state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) * static_cast<std::int64_t>(bytes));
+	state.counters["ns_per_message"] = benchmark::Counter(
+		static_cast<double>(total) * 1e-9,
+		benchmark::Counter::kIsRate | benchmark::Counter::kInvert
+	);
+}
+
+template <class Handler, class Policy = itch::policy::Switch>
+void benchmarkFile(benchmark::State& state) {
+	warmCache();
+
+	for (auto _ : state) {
+		Handler h;
+		itch::Parser<Handler, Policy> p(input_path, h);
+
+		while (p.next()) {
+			p.callHandler();
+		}
+
+		benchmark::ClobberMemory();
+	}
+
+	setCounters(state, input_messages, input_bytes);
+}
+
+// Messages of one type, length fields left out, taken from a synthetic day of adds and that
+// type (so that order messages have orders to hit), and repeated to 64K messages.
+std::vector<std::uint8_t> messagesOfType(const std::uint8_t type) {
+	itch::synth::GeneratorOptions options;
+	options.messages = 200'000;
+	options.symbols = 1'000;
+	options.mix = {};
+	options.mix['A'] = 1;
+	options.mix['P'] = type == 'B' ? 1 : 0; // Broken trades need trades.
+	options.mix[type] = 1;
+	const std::vector<std::uint8_t> day = itch::synth::generate(options);
+
+	std::vector<std::uint8_t> found;
+	for (std::size_t i = 0; i + 2 < day.size();) {
+		const std::size_t len = static_cast<std::size_t>(day[i] << 8 | day[i + 1]);
+		if (day[i + 2] == type)
+			found.insert(found.end(), day.data() + i + 2, day.data() + i + 2 + len);
+		i += 2 + len;
+	}
+
+	const std::size_t size = static_cast<std::size_t>(itch::spec::MESSAGE_LENGTH[type]) << 16;
+	std::vector<std::uint8_t> buffer;
+	buffer.reserve(size);
+	while (!found.empty() && buffer.size() < size) {
+		buffer.insert(buffer.end(), found.begin(), found.begin() + static_cast<std::ptrdiff_t>(std::min(found.size(), size - buffer.size())));
+	}
+	return buffer;
+}
+
+template <class View>
+void benchmarkDecode(benchmark::State& state, const std::uint8_t type) {
+	const std::vector<std::uint8_t> buffer = messagesOfType(type);
+	const std::size_t len = itch::spec::MESSAGE_LENGTH[type];
+	if (buffer.empty()) {
+		state.SkipWithError("no messages of this type");
+		return;
+	}
+
+	for (auto _ : state) {
+		for (std::size_t i = 0; i < buffer.size(); i += len) {
+			auto m = View{buffer.data() + i}.unbox();
+			benchmark::DoNotOptimize(m);
+		}
+	}
+
+	setCounters(state, buffer.size() / len, buffer.size());
+}
+
+void benchmarkToString(benchmark::State& state) {
+	// The first million messages, or all of them.
+	std::vector<std::uint8_t> prefix;
+	std::uint64_t messages = 0;
+	{
+		const itch::mmap::MemoryMap map(input_path);
+		const std::uint8_t* p = map.data();
+		const std::uint8_t* const end = p + map.size();
+		while (messages < 1'000'000 && p + 2 <= end) {
+			p += 2 + (p[0] << 8 | p[1]);
+			++messages;
+		}
+		prefix.assign(map.data(), std::min(p, end));
+	}
+
+	std::uint64_t text = 0;
+	for (auto _ : state) {
+		HandlerToString h;
+		itch::Parser<HandlerToString> p(std::span<const std::uint8_t>(prefix), h);
+
+		while (p.next()) {
+			p.callHandler();
+		}
+
+		text += h.bytes;
+	}
+
+	setCounters(state, messages, prefix.size());
+	state.counters["text_bytes_per_second"] = benchmark::Counter(static_cast<double>(text), benchmark::Counter::kIsRate);
+}
+
+#ifndef _WIN32
+// Drops the file's pages from the page cache. Returns the part still resident after, which
+// is all of it where pages can't be dropped, as on tmpfs.
+double dropCache() {
+	const int fd = ::open(input_path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return 1;
+	::fdatasync(fd);
+
+	double resident = 1;
+	if (::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0 && input_bytes != 0) {
+		void* const addr = ::mmap(nullptr, input_bytes, PROT_READ, MAP_SHARED, fd, 0);
+		if (addr != MAP_FAILED) {
+			const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+			std::vector<unsigned char> pages((input_bytes + page - 1) / page);
+			if (::mincore(addr, input_bytes, pages.data()) == 0) {
+				const auto count = std::count_if(pages.begin(), pages.end(), [](const unsigned char c) { return c & 1; });
+				resident = static_cast<double>(count) / static_cast<double>(pages.size());
+			}
+			::munmap(addr, input_bytes);
+		}
+	}
+
+	::close(fd);
+	return resident;
+}
+#endif
+
+// Walks the file with its pages cached, or with none.
+void benchmarkCache(benchmark::State& state, const bool cold) {
+	if (!cold) warmCache();
+
+#ifdef _WIN32
+	if (cold) {
+		state.SkipWithError("can't drop the page cache on this platform");
+		return;
+	}
+#endif
+
+	double resident = 0;
+	for (auto _ : state) {
+#ifndef _WIN32
+		if (cold) {
+			state.PauseTiming();
+			resident = std::max(resident, dropCache());
+			state.ResumeTiming();
+			if (resident > 0.5) {
+				state.SkipWithError("can't drop the page cache of the input");
+				break;
+			}
+		}
+#endif
+
+		HandlerAllEmpty h;
+		itch::Parser<HandlerAllEmpty> p(input_path, h);
+
+		while (p.next()) {
+			p.callHandler();
+		}
+
+		benchmark::ClobberMemory();
+	}
+
+	setCounters(state, input_messages, input_bytes);
+	if (cold) state.counters["resident_after_drop"] = resident;
+}
+
+// Takes --itch_file and --messages out of argv, and sets up the input.
+void setUp(int& argc, char** argv) {
+	std::uint64_t messages = 10'000'000;
+
+	int kept = 1;
+	for (int i = 1; i < argc; ++i) {
+		const std::string_view arg = argv[i];
+		if (arg.starts_with("--itch_file=")) {
+			input_path = arg.substr(12);
+		} else if (arg.starts_with("--messages=")) {
+			messages = std::strtoull(argv[i] + 11, nullptr, 10);
+		} else {
+			argv[kept++] = argv[i];
+		}
+	}
+	argc = kept;
+
+	if (input_path.empty()) {
+		input_path = "./tv_itch50_cpp_bench_" + std::to_string(messages) + ".itch";
+		if (!std::filesystem::exists(input_path)) {
+			itch::synth::GeneratorOptions options;
+			options.messages = messages;
+			itch::synth::write_file(input_path, options);
+		}
+		benchmark::AddCustomContext("input", "synthetic");
+	} else {
+		benchmark::AddCustomContext("input", input_path);
+	}
+
+	HandlerAllUndef h;
+	itch::Parser<HandlerAllUndef> p(input_path, h);
+	while (p.next()) {
+		++input_messages;
+	}
+	input_bytes = std::filesystem::file_size(input_path);
+	benchmark::AddCustomContext("input_messages", std::to_string(input_messages));
+	benchmark::AddCustomContext("input_bytes", std::to_string(input_bytes));
+}
+
+struct DecodeBenchmark {
+	const char* name;
+	std::uint8_t type;
+	void (*function)(benchmark::State&, std::uint8_t);
+};
+
+constexpr DecodeBenchmark DECODE_BENCHMARKS[] = {
+	{"SystemEvent", 'S', benchmarkDecode<view::SystemEventView>},
+	{"StockDirectory", 'R', benchmarkDecode<view::StockDirectoryView>},
+	{"StockTradingAction", 'H', benchmarkDecode<view::StockTradingActionView>},
+	{"RegSHORestriction", 'Y', benchmarkDecode<view::RegSHORestrictionView>},
+	{"MarketParticipantPosition", 'L', benchmarkDecode<view::MarketParticipantPositionView>},
+	{"MWCBDeclineLevel", 'V', benchmarkDecode<view::MWCBDeclineLevelView>},
+	{"MWCBStatus", 'W', benchmarkDecode<view::MWCBStatusView>},
+	{"IPOQuotingPeriodUpdate", 'K', benchmarkDecode<view::IPOQuotingPeriodUpdateView>},
+	{"LULDAuctionCollar", 'J', benchmarkDecode<view::LULDAuctionCollarView>},
+	{"OperationalHalt", 'h', benchmarkDecode<view::OperationalHaltView>},
+	{"AddOrder", 'A', benchmarkDecode<view::AddOrderView>},
+	{"AddOrderWithMPID", 'F', benchmarkDecode<view::AddOrderWithMPIDView>},
+	{"ExecuteOrder", 'E', benchmarkDecode<view::ExecuteOrderView>},
+	{"ExecuteOrderWithPrice", 'C', benchmarkDecode<view::ExecuteOrderWithPriceView>},
+	{"CancelOrder", 'X', benchmarkDecode<view::CancelOrderView>},
+	{"DeleteOrder", 'D', benchmarkDecode<view::DeleteOrderView>},
+	{"ReplaceOrder", 'U', benchmarkDecode<view::ReplaceOrderView>},
+	{"NonCrossTrade", 'P', benchmarkDecode<view::NonCrossTradeView>},
+	{"CrossTrade", 'Q', benchmarkDecode<view::CrossTradeView>},
+	{"BrokenTrade", 'B', benchmarkDecode<view::BrokenTradeView>},
+	{"NetOrderImbalance", 'I', benchmarkDecode<view::NetOrderImbalanceView>},
+	{"RetailPriceImprovement", 'N', benchmarkDecode<view::RetailPriceImprovementView>},
+	{"DLCRPriceDiscovery", 'O', benchmarkDecode<view::DLCRPriceDiscoveryView>},
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+	setUp(argc, argv);
+
+	benchmark::RegisterBenchmark("walk", benchmarkFile<HandlerAllUndef>);
+	benchmark::RegisterBenchmark("dispatch/Switch", benchmarkFile<HandlerAllEmpty, itch::policy::Switch>);
+	benchmark::RegisterBenchmark("dispatch/Table", benchmarkFile<HandlerAllEmpty, itch::policy::Table>);
+	benchmark::RegisterBenchmark("dispatch/ComputedGoto", benchmarkFile<HandlerAllEmpty, itch::policy::ComputedGoto>);
+	benchmark::RegisterBenchmark("dispatch/HotFirst", benchmarkFile<HandlerAllEmpty, itch::policy::HotFirst>);
+	benchmark::RegisterBenchmark("dispatch/Instrumented", benchmarkFile<HandlerAllEmpty, itch::policy::Instrumented<>>);
+	benchmark::RegisterBenchmark("unbox", benchmarkFile<HandlerAllCopy>);
+	for (const auto& b : DECODE_BENCHMARKS) {
+		benchmark::RegisterBenchmark((std::string("decode/") + b.name).c_str(), b.function, b.type);
+	}
+	benchmark::RegisterBenchmark("to_string", benchmarkToString)->Unit(benchmark::kMillisecond);
+	// Rates in wall time: a cold run mostly waits on the disk.
+	benchmark::RegisterBenchmark("cache/warm", benchmarkCache, false)->UseRealTime()->Unit(benchmark::kMillisecond);
+	benchmark::RegisterBenchmark("cache/cold", benchmarkCache, true)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+	// JSON unless asked otherwise.
+	std::vector<char*> args(argv, argv + argc);
+	std::string json = "--benchmark_format=json";
+	if (std::none_of(args.begin(), args.end(), [](const char* arg) { return std::string_view(arg).starts_with("--benchmark_format"); }))
+		args.push_back(json.data());
+	int count = static_cast<int>(args.size());
+
+	benchmark::Initialize(&count, args.data());
+	if (benchmark::ReportUnrecognizedArguments(count, args.data()))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -0,0 +1,191 @@
+#include "itch/book/book.hpp"
+#include "itch/spec/messages.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace itch::book {
+
+namespace {
+
+// Levels are sorted from worst to best: ascending price for bids, descending for asks.
+bool is_worse(const bool is_bid, const std::uint32_t a, const std::uint32_t b) noexcept {
+	return is_bid ? a < b : a > b;
+}
+
+const OrderBook EMPTY_BOOK{};
+
+} // namespace
+
+OrderBookMaster::OrderBookMaster(const std::size_t expected_orders)
+{
+	books.resize(1u << 16); // One per possible stock_locate; an empty book is two empty vectors.
+	orders.reserve(expected_orders);
+	levels.reserve(expected_orders / 4);
+}
+
+void OrderBookMaster::onAddOrder(const spec::view::AddOrderView v) {
+	add(v.order_id(), v.stock_locate(), v.side(), v.price(), v.shares());
+}
+
+void OrderBookMaster::onAddOrderWithMPID(const spec::view::AddOrderWithMPIDView v) {
+	add(v.order_id(), v.stock_locate(), v.side(), v.price(), v.shares());
+}
+
+void OrderBookMaster::onExecuteOrder(const spec::view::ExecuteOrderView v) {
+	reduce(v.order_id(), v.executed_shares());
+}
+
+void OrderBookMaster::onExecuteOrderWithPrice(const spec::view::ExecuteOrderWithPriceView v) {
+	reduce(v.order_id(), v.executed_shares());
+}
+
+void OrderBookMaster::onCancelOrder(const spec::view::CancelOrderView v) {
+	reduce(v.order_id(), v.cancelled_shares());
+}
+
+void OrderBookMaster::onDeleteOrder(const spec::view::DeleteOrderView v) {
+	const std::uint32_t* const oi = ids.find(v.order_id());
+	if (!oi) {
+		++unknown;
+		return;
+	}
+	remove(*oi);
+}
+
+void OrderBookMaster::onReplaceOrder(const spec::view::ReplaceOrderView v) {
+	// A replace keeps the locate and side of the old order, but loses its time priority.
+	const std::uint32_t* const found = ids.find(v.order_id_old());
+	if (!found) {
+		++unknown;
+		return;
+	}
+	const std::uint32_t oi = *found;
+	const std::uint16_t locate = orders[oi].stock_locate;
+	const std::uint8_t side = orders[oi].side;
+	remove(oi);
+	add(v.order_id_new(), locate, side, v.price(), v.shares());
+}
+
+const OrderBook& OrderBookMaster::book(const std::uint16_t stock_locate) const noexcept {
+	return stock_locate < books.size() ? books[stock_locate] : EMPTY_BOOK;
+}
+
+const Level* OrderBookMaster::best_bid(const std::uint16_t stock_locate) const noexcept {
+	const auto& side_levels = book(stock_locate).bid_levels;
+	return side_levels.empty() ? nullptr : &levels[side_levels.back()];
+}
+
+const Level* OrderBookMaster::best_ask(const std::uint16_t stock_locate) const noexcept {
+	const auto& side_levels = book(stock_locate).ask_levels;
+	return side_levels.empty() ? nullptr : &levels[side_levels.back()];
+}
+
+const Order* OrderBookMaster::find(const std::uint64_t order_id) const noexcept {
+	const std::uint32_t* const oi = ids.find(order_id);
+	return oi ? &orders[*oi] : nullptr;
+}
+
+void OrderBookMaster::add(
+	const std::uint64_t order_id,
+	const std::uint16_t stock_locate,
+	const std::uint8_t side,
+	const std::uint32_t price,
+	const std::uint32_t shares
+) {
+	// Overwriting the id would leave the live order in its level, out of reach.
+	if (ids.find(order_id)) {
+		++duplicate;
+		return;
+	}
+
+	OrderBook& b = books[stock_locate];
+	const bool is_bid = side == 'B';
+	const std::uint32_t li = find_or_add_level(is_bid ? b.bid_levels : b.ask_levels, is_bid, price);
+	const std::uint32_t oi = orders.alloc();
+
+	Level& l = levels[li];
+	orders[oi] = {order_id, shares, price, li, l.tail, NIL, stock_locate, side};
+	if (l.tail != NIL) {
+		orders[l.tail].next = oi;
+	} else {
+		l.head = oi;
+	}
+	l.tail = oi;
+	l.shares += shares;
+	++l.order_count;
+
+	ids.insert(order_id, oi);
+}
+
+void OrderBookMaster::reduce(const std::uint64_t order_id, const std::uint32_t shares) {
+	const std::uint32_t* const found = ids.find(order_id);
+	if (!found) {
+		++unknown;
+		return;
+	}
+
+	const std::uint32_t oi = *found;
+	Order& o = orders[oi];
+	if (shares >= o.shares) {
+		remove(oi);
+		return;
+	}
+	o.shares -= shares;
+	levels[o.level].shares -= shares;
+}
+
+void OrderBookMaster::remove(const std::uint32_t oi) {
+	const Order& o = orders[oi];
+	Level& l = levels[o.level];
+
+	if (o.prev != NIL) orders[o.prev].next = o.next; else l.head = o.next;
+	if (o.next != NIL) orders[o.next].prev = o.prev; else l.tail = o.prev;
+	l.shares -= o.shares;
+	--l.order_count;
+
+	if (l.order_count == 0) {
+		OrderBook& b = books[o.stock_locate];
+		const bool is_bid = o.side == 'B';
+		remove_level(is_bid ? b.bid_levels : b.ask_levels, is_bid, o.level);
+	}
+
+	ids.erase(o.order_id);
+	orders.release(oi);
+}
+
+std::uint32_t OrderBookMaster::find_or_add_level(
+	std::vector<std::uint32_t>& side_levels,
+	const bool is_bid,
+	const std::uint32_t price
+) {
+	const auto it = std::lower_bound(side_levels.begin(), side_levels.end(), price,
+		[&](const std::uint32_t li, const std::uint32_t p) {
+			return is_worse(is_bid, levels[li].price, p);
+		});
+	if (it != side_levels.end() && levels[*it].price == price)
+		return *it;
+
+	const std::uint32_t li = levels.alloc();
+	levels[li] = {0, price, 0, NIL, NIL};
+	side_levels.insert(it, li);
+	return li;
+}
+
+void OrderBookMaster::remove_level(
+	std::vector<std::uint32_t>& side_levels,
+	const bool is_bid,
+	const std::uint32_t li
+) {
+	const std::uint32_t price = levels[li].price;
+	const auto it = std::lower_bound(side_levels.begin(), side_levels.end(), price,
+		[&](const std::uint32_t lj, const std::uint32_t p) {
+			return is_worse(is_bid, levels[lj].price, p);
+		});
+	side_levels.erase(it);
+	levels.release(li);
+}
+
+} // namespace itch::book
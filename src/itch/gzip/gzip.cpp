@@ -0,0 +1,401 @@
+#include "itch/gzip/gzip.hpp"
+#include "itch/util/util.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace itch::gzip {
+
+namespace {
+
+// Sidecar layout, all fields in native byte order (like the MessageIndex sidecar, it's a
+// cache, not a format meant to be shared between machines):
+//   char[8]  magic
+//   uint64   size of the .gz file
+//   uint64   modification time of the .gz file, in the file clock's ticks
+//   uint64   uncompressed size
+//   uint64   total message count
+//   uint64   span
+//   uint64   number of points
+//   per point: uint64 in, uint64 out, uint64 first_msg, uint64 bits, uint8[WINDOW_SIZE] window
+constexpr char SIDECAR_MAGIC[8] = {'I', 'T', 'C', 'H', 'G', 'Z', 'X', '2'};
+
+constexpr std::size_t INPUT_SIZE = 256u << 10;
+
+using File = std::unique_ptr<std::FILE, decltype(&std::fclose)>;
+
+File open_file(const std::string& path, const char* mode) {
+	return File(std::fopen(path.c_str(), mode), &std::fclose);
+}
+
+// A file replaced by another of the same size is told apart by this.
+std::uint64_t modification_time(const std::string& path) {
+	std::error_code ec;
+	const auto time = std::filesystem::last_write_time(path, ec);
+	if (ec)
+		throw std::runtime_error("GzipIndex error: could not stat " + path);
+	return static_cast<std::uint64_t>(time.time_since_epoch().count());
+}
+
+bool seek(std::FILE* file, const std::uint64_t offset) noexcept {
+#ifdef _WIN32
+	return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+	return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+bool write_u64(std::FILE* out, const std::uint64_t value) {
+	return std::fwrite(&value, sizeof(value), 1, out) == 1;
+}
+
+bool read_u64(std::FILE* in, std::uint64_t& value) {
+	return std::fread(&value, sizeof(value), 1, in) == 1;
+}
+
+// A z_stream that is always ended. window_bits as for inflateInit2: 15 + 32 detects the gzip
+// (or zlib) header, -15 is a raw deflate stream.
+struct Inflate {
+	z_stream z{};
+
+	explicit Inflate(const int window_bits) {
+		if (inflateInit2(&z, window_bits) != Z_OK)
+			throw std::runtime_error("gzip error: could not initialize zlib");
+	}
+
+	Inflate(const Inflate&) = delete;
+	Inflate& operator=(const Inflate&) = delete;
+
+	~Inflate() { inflateEnd(&z); }
+};
+
+// Reads the next chunk of input into z, if it ran out. Returns false at the end of the file.
+bool refill(z_stream& z, std::FILE* in, std::vector<std::uint8_t>& input, const char* who) {
+	if (z.avail_in != 0) return true;
+
+	const std::size_t n = std::fread(input.data(), 1, input.size(), in);
+	if (n == 0 && std::ferror(in))
+		throw std::runtime_error(std::string(who) + " error: could not read the file");
+	z.next_in = input.data();
+	z.avail_in = static_cast<uInt>(n);
+	return n != 0;
+}
+
+[[noreturn]] void fail(const z_stream& z, const char* who) {
+	throw std::runtime_error(std::string(who) + " error: " + (z.msg ? z.msg : "corrupt data"));
+}
+
+} // namespace
+
+// --- GzipIndex ---
+
+GzipIndex GzipIndex::build(const std::string& filepath, const std::uint64_t span) {
+	if (span == 0)
+		throw std::invalid_argument("GzipIndex error: span must be non-zero");
+
+	const File in = open_file(filepath, "rb");
+	if (!in)
+		throw std::runtime_error("GzipIndex error: could not open " + filepath);
+
+	GzipIndex idx;
+	idx.file_size_ = std::filesystem::file_size(filepath);
+	idx.span_ = span;
+
+	// Inflate straight into a circular window: the byte at uncompressed offset o goes to
+	// window[o % WINDOW_SIZE].
+	Inflate inflater(15 + 32);
+	z_stream& z = inflater.z;
+	std::vector<std::uint8_t> input(INPUT_SIZE);
+	std::vector<std::uint8_t> window(WINDOW_SIZE);
+
+	std::uint64_t total_in = 0;
+	std::uint64_t total_out = 0;
+	std::uint64_t last = 0;
+	std::uint64_t next_msg = 0;     // Start of the next message not walked yet.
+	std::size_t pending = 0;        // First point with no first_msg yet.
+	int ret = Z_OK;
+
+	while (ret != Z_STREAM_END) {
+		if (!refill(z, in.get(), input, "GzipIndex"))
+			throw std::runtime_error("GzipIndex error: file is truncated");
+
+		do {
+			// At most half a window per call, so a length field split across two calls is
+			// still in there.
+			const std::size_t pos = total_out % WINDOW_SIZE;
+			z.next_out = window.data() + pos;
+			z.avail_out = static_cast<uInt>(std::min(WINDOW_SIZE - pos, WINDOW_SIZE / 2));
+
+			// Z_BLOCK stops at the end of the header and of every deflate block.
+			total_in += z.avail_in;
+			total_out += z.avail_out;
+			ret = inflate(&z, Z_BLOCK);
+			total_in -= z.avail_in;
+			total_out -= z.avail_out;
+			if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR)
+				fail(z, "GzipIndex");
+
+			for (;;) {
+				for (; pending < idx.points_.size() && idx.points_[pending].out <= next_msg; ++pending) {
+					idx.points_[pending].first_msg = next_msg;
+				}
+				if (next_msg + 2 > total_out) break;
+
+				const std::uint8_t len[2] = {
+					window[next_msg % WINDOW_SIZE],
+					window[(next_msg + 1) % WINDOW_SIZE]
+				};
+				next_msg += 2 + util::read_be<std::uint16_t>(len);
+				++idx.message_count_;
+			}
+
+			if (ret == Z_STREAM_END) break;
+
+			// Bit 7 of data_type: at a block boundary; bit 6: after the last block.
+			if ((z.data_type & 128) && !(z.data_type & 64) &&
+			    (total_out == 0 || total_out - last > span)) {
+				AccessPoint& point = idx.points_.emplace_back();
+				point.in = total_in;
+				point.out = total_out;
+				point.bits = static_cast<std::uint8_t>(z.data_type & 7);
+				point.window.resize(WINDOW_SIZE);
+				// Oldest byte first: the part from the write position on, then the part before.
+				const std::size_t at = total_out % WINDOW_SIZE;
+				std::memcpy(point.window.data(), window.data() + at, WINDOW_SIZE - at);
+				std::memcpy(point.window.data() + WINDOW_SIZE - at, window.data(), at);
+				last = total_out;
+			}
+		} while (z.avail_in != 0);
+	}
+
+	if (z.avail_in != 0 || refill(z, in.get(), input, "GzipIndex"))
+		throw std::runtime_error("GzipIndex error: data after the first member "
+		                         "(multi-member files can't be indexed)");
+	if (next_msg != total_out)
+		throw std::runtime_error("GzipIndex error: last message is truncated");
+
+	idx.size_ = total_out;
+	return idx;
+}
+
+GzipIndex GzipIndex::load(const std::string& filepath) {
+	const File in = open_file(sidecar_path(filepath), "rb");
+	if (!in)
+		throw std::runtime_error("GzipIndex error: could not open sidecar");
+
+	char magic[sizeof(SIDECAR_MAGIC)];
+	if (std::fread(magic, sizeof(magic), 1, in.get()) != 1 ||
+	    std::memcmp(magic, SIDECAR_MAGIC, sizeof(magic)) != 0)
+		throw std::runtime_error("GzipIndex error: sidecar has bad magic");
+
+	GzipIndex idx;
+	std::uint64_t mtime = 0;
+	std::uint64_t count = 0;
+	if (!read_u64(in.get(), idx.file_size_) ||
+	    !read_u64(in.get(), mtime) ||
+	    !read_u64(in.get(), idx.size_) ||
+	    !read_u64(in.get(), idx.message_count_) ||
+	    !read_u64(in.get(), idx.span_) ||
+	    !read_u64(in.get(), count))
+		throw std::runtime_error("GzipIndex error: sidecar header is truncated");
+
+	std::error_code ec;
+	if (idx.file_size_ != std::filesystem::file_size(filepath, ec) || ec)
+		throw std::runtime_error("GzipIndex error: sidecar was built for another file size");
+	if (mtime != modification_time(filepath))
+		throw std::runtime_error("GzipIndex error: file changed since the sidecar was built");
+
+	// A point per compressed byte would already be absurd.
+	if (count > idx.file_size_)
+		throw std::runtime_error("GzipIndex error: sidecar point count is corrupt");
+
+	idx.points_.resize(count);
+	std::uint64_t prev_out = 0;
+	for (AccessPoint& point : idx.points_) {
+		std::uint64_t bits = 0;
+		point.window.resize(WINDOW_SIZE);
+		if (!read_u64(in.get(), point.in) ||
+		    !read_u64(in.get(), point.out) ||
+		    !read_u64(in.get(), point.first_msg) ||
+		    !read_u64(in.get(), bits) ||
+		    std::fread(point.window.data(), 1, WINDOW_SIZE, in.get()) != WINDOW_SIZE)
+			throw std::runtime_error("GzipIndex error: sidecar points are truncated");
+
+		if (bits > 7 || point.in > idx.file_size_ || point.out < prev_out ||
+		    point.first_msg < point.out || point.first_msg > idx.size_)
+			throw std::runtime_error("GzipIndex error: sidecar points are corrupt");
+		point.bits = static_cast<std::uint8_t>(bits);
+		prev_out = point.out;
+	}
+
+	return idx;
+}
+
+GzipIndex GzipIndex::load_or_build(const std::string& filepath, const std::uint64_t span) {
+	try {
+		auto idx = load(filepath);
+		if (idx.span_ == span)
+			return idx;
+	} catch (const std::runtime_error&) {
+		// Missing or stale sidecar; rebuild below.
+	}
+
+	auto idx = build(filepath, span);
+	try {
+		idx.save(filepath);
+	} catch (const std::runtime_error&) {
+		// Not being able to cache the index only costs us a rebuild next time.
+	}
+	return idx;
+}
+
+// Written to a temporary file that is then renamed over the sidecar, so a crash never leaves
+// a truncated one behind.
+void GzipIndex::save(const std::string& filepath) const {
+	const std::uint64_t mtime = modification_time(filepath);
+	const std::string path = sidecar_path(filepath);
+	const std::string temp = path + ".tmp" +
+		std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+
+	File out = open_file(temp, "wb");
+	if (!out)
+		throw std::runtime_error("GzipIndex error: could not create sidecar");
+
+	bool is_written =
+		std::fwrite(SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC), 1, out.get()) == 1 &&
+		write_u64(out.get(), file_size_) &&
+		write_u64(out.get(), mtime) &&
+		write_u64(out.get(), size_) &&
+		write_u64(out.get(), message_count_) &&
+		write_u64(out.get(), span_) &&
+		write_u64(out.get(), points_.size());
+
+	for (const AccessPoint& point : points_) {
+		is_written = is_written &&
+			write_u64(out.get(), point.in) &&
+			write_u64(out.get(), point.out) &&
+			write_u64(out.get(), point.first_msg) &&
+			write_u64(out.get(), point.bits) &&
+			point.window.size() == WINDOW_SIZE &&
+			std::fwrite(point.window.data(), 1, WINDOW_SIZE, out.get()) == WINDOW_SIZE;
+	}
+
+	const bool is_closed = std::fclose(out.release()) == 0;
+
+	std::error_code ec;
+	if (is_written && is_closed) {
+		std::filesystem::rename(temp, path, ec);
+		if (!ec) return;
+	}
+	std::filesystem::remove(temp, ec);
+	throw std::runtime_error("GzipIndex error: could not write sidecar");
+}
+
+std::string GzipIndex::sidecar_path(const std::string& filepath) {
+	return filepath + ".gzidx";
+}
+
+// --- GzipReader ---
+
+struct GzipReader::State {
+	File in;
+	Inflate inflater;
+	std::vector<std::uint8_t> input;
+	std::uint64_t position = 0;
+	bool is_raw;  // Started from an access point, so there are no headers to go through.
+	bool is_done = false;
+
+	State(const std::string& filepath, const int window_bits)
+	: in(open_file(filepath, "rb"))
+	, inflater(window_bits)
+	, input(INPUT_SIZE)
+	, is_raw(window_bits < 0)
+	{
+		if (!in)
+			throw std::runtime_error("GzipReader error: could not open " + filepath);
+	}
+};
+
+GzipReader::GzipReader(const std::string& filepath)
+: state(std::make_unique<State>(filepath, 15 + 32))
+{/*no-op*/}
+
+GzipReader::GzipReader(const std::string& filepath, const AccessPoint& point)
+: state(std::make_unique<State>(filepath, -15))
+{
+	z_stream& z = state->inflater.z;
+	std::FILE* const in = state->in.get();
+
+	if (point.window.size() != WINDOW_SIZE || !seek(in, point.in - (point.bits ? 1 : 0)))
+		throw std::runtime_error("GzipReader error: could not seek to the access point");
+
+	if (point.bits) {
+		const int c = std::fgetc(in);
+		if (c == EOF || inflatePrime(&z, point.bits, c >> (8 - point.bits)) != Z_OK)
+			throw std::runtime_error("GzipReader error: could not seek to the access point");
+	}
+	if (inflateSetDictionary(&z, point.window.data(), WINDOW_SIZE) != Z_OK)
+		fail(z, "GzipReader");
+
+	state->position = point.out;
+}
+
+GzipReader::~GzipReader() = default;
+
+std::size_t GzipReader::read(std::uint8_t* const buf, const std::size_t size) {
+	State& s = *state;
+	z_stream& z = s.inflater.z;
+	z.next_out = buf;
+	z.avail_out = static_cast<uInt>(std::min<std::size_t>(size, UINT_MAX));
+	const uInt wanted = z.avail_out;
+
+	while (z.avail_out != 0 && !s.is_done) {
+		if (!refill(z, s.in.get(), s.input, "GzipReader"))
+			throw std::runtime_error("GzipReader error: file is truncated");
+
+		const int ret = inflate(&z, Z_NO_FLUSH);
+		if (ret == Z_STREAM_END) {
+			// A raw stream stops at its last block, before the trailer. Otherwise, go on to
+			// the next member, if any.
+			if (s.is_raw || !refill(z, s.in.get(), s.input, "GzipReader")) {
+				s.is_done = true;
+			} else if (inflateReset(&z) != Z_OK) {
+				fail(z, "GzipReader");
+			}
+		} else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+			fail(z, "GzipReader");
+		}
+	}
+
+	const std::size_t n = wanted - z.avail_out;
+	s.position += n;
+	return n;
+}
+
+void GzipReader::skip(std::uint64_t size) {
+	std::vector<std::uint8_t> scratch(std::min<std::uint64_t>(size, 256u << 10));
+	while (size != 0) {
+		const std::size_t n = read(scratch.data(), std::min<std::uint64_t>(size, scratch.size()));
+		if (n == 0)
+			throw std::runtime_error("GzipReader error: skipped past the end");
+		size -= n;
+	}
+}
+
+std::uint64_t GzipReader::position() const noexcept {
+	return state->position;
+}
+
+} // namespace itch::gzip
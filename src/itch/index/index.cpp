@@ -0,0 +1,264 @@
+#include "itch/index/index.hpp"
+#include "itch/spec/messages.hpp"
+#include "itch/util/util.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace itch::index {
+
+namespace {
+
+// Sidecar layout, all fields in native byte order (the sidecar is a cache, not a format
+// meant to be shared between machines):
+//   char[8]  magic
+//   uint64   file size of the indexed input
+//   uint64   modification time of the indexed input, in the file clock's ticks
+//   uint64   total message count
+//   uint64   stride
+//   uint64   stride kind
+//   uint64   number of offsets
+//   uint64[] offsets
+constexpr char SIDECAR_MAGIC[8] = {'I', 'T', 'C', 'H', 'I', 'D', 'X', '2'};
+
+using File = std::unique_ptr<std::FILE, decltype(&std::fclose)>;
+
+File open_file(const std::string& path, const char* mode) {
+	return File(std::fopen(path.c_str(), mode), &std::fclose);
+}
+
+// A file replaced by another of the same size is told apart by this.
+std::uint64_t modification_time(const std::string& path) {
+	std::error_code ec;
+	const auto time = std::filesystem::last_write_time(path, ec);
+	if (ec)
+		throw std::runtime_error("MessageIndex error: could not stat " + path);
+	return static_cast<std::uint64_t>(time.time_since_epoch().count());
+}
+
+bool write_u64(std::FILE* out, const std::uint64_t value) {
+	return std::fwrite(&value, sizeof(value), 1, out) == 1;
+}
+
+bool read_u64(std::FILE* in, std::uint64_t& value) {
+	return std::fread(&value, sizeof(value), 1, in) == 1;
+}
+
+} // namespace
+
+MessageIndex MessageIndex::build(
+	const std::uint8_t* const data,
+	const std::size_t size,
+	const std::uint64_t stride,
+	const StrideKind kind
+) {
+	if (stride == 0)
+		throw std::invalid_argument("MessageIndex error: stride must be non-zero");
+
+	MessageIndex idx;
+	idx.file_size_ = size;
+	idx.stride_ = stride;
+	idx.kind_ = kind;
+
+	std::uint64_t pos = 0;
+	std::uint64_t count = 0;
+	std::uint64_t next_mark = 0;
+
+	while (pos + 2 <= size) {
+		if (kind == MESSAGES) {
+			if (count % stride == 0)
+				idx.offsets_.push_back(pos);
+		} else if (pos >= next_mark) {
+			idx.offsets_.push_back(pos);
+			next_mark = (pos / stride + 1) * stride;
+		}
+
+		pos += 2 + util::read_be<std::uint16_t>(data + pos);
+		++count;
+	}
+
+	if (pos != size)
+		throw std::runtime_error("MessageIndex error: last message is truncated");
+
+	idx.message_count_ = count;
+	return idx;
+}
+
+MessageIndex MessageIndex::load(const std::string& filepath, const std::size_t file_size) {
+	const File in = open_file(sidecar_path(filepath), "rb");
+	if (!in)
+		throw std::runtime_error("MessageIndex error: could not open sidecar");
+
+	char magic[sizeof(SIDECAR_MAGIC)];
+	if (std::fread(magic, sizeof(magic), 1, in.get()) != 1 ||
+	    std::memcmp(magic, SIDECAR_MAGIC, sizeof(magic)) != 0)
+		throw std::runtime_error("MessageIndex error: sidecar has bad magic");
+
+	MessageIndex idx;
+	std::uint64_t mtime = 0;
+	std::uint64_t kind = 0;
+	std::uint64_t count = 0;
+	if (!read_u64(in.get(), idx.file_size_) ||
+	    !read_u64(in.get(), mtime) ||
+	    !read_u64(in.get(), idx.message_count_) ||
+	    !read_u64(in.get(), idx.stride_) ||
+	    !read_u64(in.get(), kind) ||
+	    !read_u64(in.get(), count))
+		throw std::runtime_error("MessageIndex error: sidecar header is truncated");
+	idx.kind_ = kind == BYTES ? BYTES : MESSAGES;
+
+	if (idx.file_size_ != file_size)
+		throw std::runtime_error("MessageIndex error: sidecar was built for another file size");
+	if (mtime != modification_time(filepath))
+		throw std::runtime_error("MessageIndex error: file changed since the sidecar was built");
+
+	// Every message is at least 3 bytes, so anything beyond that is certainly corrupt.
+	if (count > file_size / 3 + 1)
+		throw std::runtime_error("MessageIndex error: sidecar offset count is corrupt");
+
+	idx.offsets_.resize(count);
+	if (std::fread(idx.offsets_.data(), sizeof(std::uint64_t), count, in.get()) != count)
+		throw std::runtime_error("MessageIndex error: sidecar offsets are truncated");
+
+	if (!std::is_sorted(idx.offsets_.begin(), idx.offsets_.end()) ||
+	    (count != 0 && (idx.offsets_.front() != 0 || idx.offsets_.back() >= file_size)))
+		throw std::runtime_error("MessageIndex error: sidecar offsets are corrupt");
+
+	return idx;
+}
+
+MessageIndex MessageIndex::load_or_build(
+	const std::string& filepath,
+	const std::uint8_t* const data,
+	const std::size_t size,
+	const std::uint64_t stride,
+	const StrideKind kind
+) {
+	try {
+		auto idx = load(filepath, size);
+		// What the size and time can't catch: every checkpoint has to start well-formed
+		// messages. This reads a few bytes per checkpoint.
+		const bool is_framed = std::all_of(idx.offsets_.begin(), idx.offsets_.end(),
+			[&](const std::uint64_t offset) { return is_chain_start(data, size, offset); });
+		if (idx.stride_ == stride && idx.kind_ == kind && is_framed)
+			return idx;
+	} catch (const std::runtime_error&) {
+		// Missing or stale sidecar; rebuild below.
+	}
+
+	auto idx = build(data, size, stride, kind);
+	try {
+		idx.save(filepath);
+	} catch (const std::runtime_error&) {
+		// Not being able to cache the index only costs us a rebuild next time.
+	}
+	return idx;
+}
+
+// Written to a temporary file that is then renamed over the sidecar, so a crash never leaves
+// a truncated one behind.
+void MessageIndex::save(const std::string& filepath) const {
+	const std::uint64_t mtime = modification_time(filepath);
+	const std::string path = sidecar_path(filepath);
+	const std::string temp = path + ".tmp" +
+		std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+
+	File out = open_file(temp, "wb");
+	if (!out)
+		throw std::runtime_error("MessageIndex error: could not create sidecar");
+
+	const bool is_written =
+		std::fwrite(SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC), 1, out.get()) == 1 &&
+		write_u64(out.get(), file_size_) &&
+		write_u64(out.get(), mtime) &&
+		write_u64(out.get(), message_count_) &&
+		write_u64(out.get(), stride_) &&
+		write_u64(out.get(), kind_) &&
+		write_u64(out.get(), offsets_.size()) &&
+		std::fwrite(offsets_.data(), sizeof(std::uint64_t), offsets_.size(), out.get())
+			== offsets_.size();
+	const bool is_closed = std::fclose(out.release()) == 0;
+
+	std::error_code ec;
+	if (is_written && is_closed) {
+		std::filesystem::rename(temp, path, ec);
+		if (!ec) return;
+	}
+	std::filesystem::remove(temp, ec);
+	throw std::runtime_error("MessageIndex error: could not write sidecar");
+}
+
+std::string MessageIndex::sidecar_path(const std::string& filepath) {
+	return filepath + ".idx";
+}
+
+std::uint64_t MessageIndex::next_checkpoint(const std::uint64_t byte_offset) const noexcept {
+	const auto it = std::lower_bound(offsets_.begin(), offsets_.end(), byte_offset);
+	return it == offsets_.end() ? file_size_ : *it;
+}
+
+bool is_chain_start(
+	const std::uint8_t* const data,
+	const std::size_t size,
+	std::uint64_t pos,
+	const std::size_t hops
+) noexcept {
+	for (std::size_t i = 0; i < hops; ++i) {
+		if (pos == size)
+			return i != 0;
+		if (pos + 3 > size)
+			return false;
+
+		const auto len = util::read_be<std::uint16_t>(data + pos);
+		if (len == 0 || len != spec::MESSAGE_LENGTH[data[pos + 2]])
+			return false;
+
+		pos += 2 + len;
+	}
+
+	return pos <= size;
+}
+
+std::uint64_t resync(
+	const std::uint8_t* const data,
+	const std::size_t size,
+	const std::uint64_t from,
+	const std::size_t hops
+) noexcept {
+	for (std::uint64_t pos = from; pos + 3 <= size; ++pos) {
+		if (is_chain_start(data, size, pos, hops))
+			return pos;
+	}
+	return size;
+}
+
+std::vector<std::uint64_t> split(
+	const std::uint8_t* const data,
+	const std::size_t size,
+	const std::size_t k,
+	const std::size_t hops
+) {
+	if (k == 0)
+		throw std::invalid_argument("split error: chunk count must be non-zero");
+
+	std::vector<std::uint64_t> cuts;
+	cuts.reserve(k + 1);
+	cuts.push_back(0);
+	for (std::size_t i = 1; i < k; ++i) {
+		const std::uint64_t target = std::max<std::uint64_t>(size / k * i, cuts.back());
+		cuts.push_back(resync(data, size, target, hops));
+	}
+	cuts.push_back(size);
+	return cuts;
+}
+
+} // namespace itch::index
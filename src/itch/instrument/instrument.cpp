@@ -0,0 +1,182 @@
+#include "itch/instrument/instrument.hpp"
+#include "itch/util/util.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+namespace itch::instrument {
+
+namespace {
+
+[[nodiscard]] const char* name(const std::uint8_t type) noexcept {
+	switch (type) {
+		case 'S': return "SystemEvent";
+		case 'R': return "StockDirectory";
+		case 'H': return "StockTradingAction";
+		case 'Y': return "RegSHORestriction";
+		case 'L': return "MarketParticipantPosition";
+		case 'V': return "MWCBDeclineLevel";
+		case 'W': return "MWCBStatus";
+		case 'K': return "IPOQuotingPeriodUpdate";
+		case 'J': return "LULDAuctionCollar";
+		case 'h': return "OperationalHalt";
+		case 'A': return "AddOrder";
+		case 'F': return "AddOrderWithMPID";
+		case 'E': return "ExecuteOrder";
+		case 'C': return "ExecuteOrderWithPrice";
+		case 'X': return "CancelOrder";
+		case 'D': return "DeleteOrder";
+		case 'U': return "ReplaceOrder";
+		case 'P': return "NonCrossTrade";
+		case 'Q': return "CrossTrade";
+		case 'B': return "BrokenTrade";
+		case 'I': return "NetOrderImbalance";
+		case 'N': return "RetailPriceImprovement";
+		case 'O': return "DLCRPriceDiscovery";
+		default:  return "(unknown)";
+	}
+}
+
+// Cheapest of a few back-to-back clock reads: what an empty handler call would record.
+[[nodiscard]] std::uint64_t clock_floor() noexcept {
+	std::uint64_t best = UINT64_MAX;
+	for (int i = 0; i < 64; ++i) {
+		const std::uint64_t begin = now();
+		const std::uint64_t end = now();
+		best = std::min(best, end - begin);
+	}
+	return best;
+}
+
+std::mutex exited_mutex;
+Stats exited;
+
+#ifdef TV_ITCH50_CPP_INSTRUMENT
+// Constructed after exited, so destroyed before it; and after the main thread's Local, which
+// has been folded into exited by then.
+struct Dump {
+	~Dump() {
+		const Stats all = collected();
+		for (const TypeStats& t : all.types) {
+			if (t.count != 0) {
+				std::fputs(report(all).c_str(), stderr);
+				return;
+			}
+		}
+	}
+} dump;
+#endif
+
+} // namespace
+
+std::uint64_t Histogram::quantile(const double q) const noexcept {
+	std::uint64_t total = 0;
+	for (const std::uint64_t n : buckets) total += n;
+	if (total == 0) return 0;
+
+	const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(total - 1));
+	std::uint64_t seen = 0;
+	for (std::size_t b = 0; b < BUCKETS; ++b) {
+		seen += buckets[b];
+		if (seen > rank) return b == 0 ? 0 : (std::uint64_t{1} << b) - 1;
+	}
+	return UINT64_MAX;
+}
+
+void Stats::merge(const Stats& other) noexcept {
+	for (std::size_t i = 0; i < types.size(); ++i) {
+		TypeStats& t = types[i];
+		const TypeStats& o = other.types[i];
+		t.count += o.count;
+		t.bytes += o.bytes;
+		t.ticks += o.ticks;
+		t.max_ticks = std::max(t.max_ticks, o.max_ticks);
+		t.histogram.merge(o.histogram);
+	}
+}
+
+detail::Local::~Local() {
+	const std::lock_guard<std::mutex> lock(exited_mutex);
+	exited.merge(stats);
+	// Zeroed, in case the main thread's is reached again from a destructor at exit.
+	stats.reset();
+}
+
+Stats collected() {
+	Stats all;
+	{
+		const std::lock_guard<std::mutex> lock(exited_mutex);
+		all = exited;
+	}
+	all.merge(stats());
+	return all;
+}
+
+std::string report(const Stats& stats) {
+	std::string out;
+	char line[160];
+
+	std::uint64_t count = 0;
+	std::uint64_t bytes = 0;
+	std::uint64_t ticks = 0;
+	for (const TypeStats& t : stats.types) {
+		count += t.count;
+		bytes += t.bytes;
+		ticks += t.ticks;
+	}
+
+	std::snprintf(line, sizeof(line), "%llu messages, %llu bytes, %.1f %s per handler call (floor %llu)\n",
+		static_cast<unsigned long long>(count), static_cast<unsigned long long>(bytes),
+		count == 0 ? 0.0 : static_cast<double>(ticks) / static_cast<double>(count), TICKS,
+		static_cast<unsigned long long>(clock_floor()));
+	out += line;
+	std::snprintf(line, sizeof(line), "%-4s %-26s %14s %16s %9s %8s %8s %10s\n",
+		"type", "name", "count", "bytes", "mean", "p50", "p99", "max");
+	out += line;
+
+	for (std::size_t type = 0; type < stats.types.size(); ++type) {
+		const TypeStats& t = stats.types[type];
+		if (t.count == 0) continue;
+		std::snprintf(line, sizeof(line), "%-4c %-26s %14llu %16llu %9.1f %8llu %8llu %10llu\n",
+			static_cast<char>(type), name(static_cast<std::uint8_t>(type)),
+			static_cast<unsigned long long>(t.count), static_cast<unsigned long long>(t.bytes),
+			static_cast<double>(t.ticks) / static_cast<double>(t.count),
+			static_cast<unsigned long long>(t.histogram.quantile(0.5)),
+			static_cast<unsigned long long>(t.histogram.quantile(0.99)),
+			static_cast<unsigned long long>(t.max_ticks));
+		out += line;
+	}
+
+	// One line per type, with "<N:count" for each non-empty bucket: count calls took less than
+	// N ticks, and at least N / 2.
+	out += "histograms (";
+	out += TICKS;
+	out += " per call):\n";
+	for (std::size_t type = 0; type < stats.types.size(); ++type) {
+		const TypeStats& t = stats.types[type];
+		if (t.count == 0) continue;
+		std::snprintf(line, sizeof(line), "%-4c", static_cast<char>(type));
+		out += line;
+		for (std::size_t b = 0; b < Histogram::BUCKETS; ++b) {
+			if (t.histogram[b] == 0) continue;
+			if (b + 1 == Histogram::BUCKETS) {
+				std::snprintf(line, sizeof(line), " >=%llu:%llu",
+					static_cast<unsigned long long>(std::uint64_t{1} << (b - 1)),
+					static_cast<unsigned long long>(t.histogram[b]));
+			} else {
+				std::snprintf(line, sizeof(line), " <%llu:%llu",
+					static_cast<unsigned long long>(std::uint64_t{1} << b),
+					static_cast<unsigned long long>(t.histogram[b]));
+			}
+			out += line;
+		}
+		out += '\n';
+	}
+	return out;
+}
+
+} // namespace itch::instrument
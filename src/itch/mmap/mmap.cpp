@@ -1,11 +1,14 @@
 #include "itch/mmap/mmap.hpp"
 
+#include <algorithm>
+#include <cerrno>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <stdexcept>
 #include <string>
 
 #ifdef _WIN32
-#include <cstdint>
 #include <windows.h>
 #else
 #include <fcntl.h>
@@ -16,8 +19,33 @@
 
 namespace itch::mmap {
 
+namespace {
+
+// [offset, offset + length) clamped to size and rounded out to whole pages. Returns false if
+// nothing is left.
+bool page_range(
+	std::size_t& offset,
+	std::size_t& length,
+	const std::size_t size,
+	const std::size_t page_size
+) noexcept {
+	if (offset >= size || length == 0) return false;
+	const std::size_t end = std::min(offset + length, size);
+	offset -= offset % page_size;
+	length = end - offset;
+	return true;
+}
+
+} // namespace
+
 #ifdef _WIN32
-MemoryMapWindows::MemoryMapWindows(const std::string& path) {
+MemoryMapWindows::MemoryMapWindows(const std::string& path, const MapOptions options)
+: window(options.window)
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	granularity = info.dwAllocationGranularity;
+
 	file = CreateFileA(
 		path.c_str(),
 		GENERIC_READ,
@@ -36,10 +64,16 @@ MemoryMapWindows::MemoryMapWindows(const std::string& path) {
 		throw std::runtime_error("MemoryMapWindows error: GetFileSizeEx failed");
 	}
 
-	size_ = static_cast<std::size_t>(sz.QuadPart);
-	if (size_ == 0)
+	file_size_ = static_cast<std::size_t>(sz.QuadPart);
+	if (file_size_ == 0)
 		throw std::runtime_error("MemoryMapWindows error: file is empty");
 
+	if (window != 0 && window < 4 * granularity) {
+		CloseHandle(file);
+		throw std::runtime_error("MemoryMapWindows error: window is too small");
+	}
+	size_ = window != 0 ? std::min(window, file_size_) : file_size_;
+
 	mapping = CreateFileMappingA(
 		file,
 		nullptr,
@@ -58,7 +92,7 @@ MemoryMapWindows::MemoryMapWindows(const std::string& path) {
 		FILE_MAP_READ,
 		0,
 		0,
-		0
+		window != 0 ? size_ : 0
 	);
 	if (!data_) {
 		CloseHandle(mapping);
@@ -67,14 +101,59 @@ MemoryMapWindows::MemoryMapWindows(const std::string& path) {
 	}
 }
 
+void MemoryMapWindows::slide(const std::size_t file_offset) {
+	if (window == 0) return;
+
+	const std::uint64_t off = file_offset - file_offset % granularity;
+	const std::size_t len = std::min(window, file_size_ - static_cast<std::size_t>(off));
+	void* const view = MapViewOfFile(
+		mapping,
+		FILE_MAP_READ,
+		static_cast<DWORD>(off >> 32),
+		static_cast<DWORD>(off & 0xFFFFFFFF),
+		len
+	);
+	if (!view)
+		throw std::runtime_error("MemoryMapWindows error: MapViewOfFile failed");
+
+	if (prev_data) UnmapViewOfFile(prev_data);
+	prev_data = data_;
+	data_ = view;
+	size_ = len;
+	offset_ = static_cast<std::size_t>(off);
+}
+
+void MemoryMapWindows::will_need(std::size_t offset, std::size_t length) const noexcept {
+	// There's no file-offset equivalent of PrefetchVirtualMemory, so a window gets no hints.
+	if (window != 0 || !page_range(offset, length, size_, 4096)) return;
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = static_cast<std::uint8_t*>(data_) + offset;
+	range.NumberOfBytes = length;
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+void MemoryMapWindows::dont_need(std::size_t offset, std::size_t length) const noexcept {
+	// Unlocking pages that aren't locked removes them from the working set. The standby list
+	// (Windows' page cache) keeps them until it needs the memory. With a window, past windows
+	// leave the working set when they're unmapped.
+	if (window != 0 || !page_range(offset, length, size_, 4096)) return;
+	VirtualUnlock(static_cast<std::uint8_t*>(data_) + offset, length);
+}
+
 MemoryMapWindows::~MemoryMapWindows() {
+	if (prev_data) UnmapViewOfFile(prev_data);
 	if (data_) UnmapViewOfFile(data_);
 	if (mapping) CloseHandle(mapping);
 	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
 }
 
 #else
-MemoryMapPosix::MemoryMapPosix(const std::string& path) {
+MemoryMapPosix::MemoryMapPosix(const std::string& path, const MapOptions options)
+: window(options.window)
+, granularity(static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)))
+, populate(options.populate)
+, huge_pages(options.huge_pages)
+{
 	fd = ::open(path.c_str(), O_RDONLY);
 	if (fd == -1)
 		throw std::runtime_error("MemoryMapPosix error: open failed");
@@ -85,28 +164,168 @@ MemoryMapPosix::MemoryMapPosix(const std::string& path) {
 		throw std::runtime_error("MemoryMapPosix error: fstat failed");
 	}
 
-	size_ = static_cast<std::size_t>(st.st_size);
-	if (size_ == 0)
+	file_size_ = static_cast<std::size_t>(st.st_size);
+	if (file_size_ == 0)
 		throw std::runtime_error("MemoryMapPosix error: file is empty");
 
-	data_ = ::mmap(
+	if (window != 0 && window < 4 * granularity) {
+		::close(fd);
+		throw std::runtime_error("MemoryMapPosix error: window is too small");
+	}
+
+	if (options.copy_to_huge_pages) {
+		if (window != 0) {
+			::close(fd);
+			throw std::runtime_error("MemoryMapPosix error: can't copy with a window");
+		}
+		if (!copy_file()) {
+			::close(fd);
+			throw std::runtime_error("MemoryMapPosix error: copy failed");
+		}
+		// Nothing needs the file anymore.
+		::close(fd);
+		fd = -1;
+		size_ = file_size_;
+		return;
+	}
+
+	size_ = window != 0 ? std::min(window, file_size_) : file_size_;
+	data_ = map_range(0, size_);
+	if (!data_) {
+		::close(fd);
+		throw std::runtime_error("MemoryMapPosix error: mmap failed");
+	}
+}
+
+void* MemoryMapPosix::map_range(const std::size_t offset, const std::size_t length) {
+	int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+	if (populate) {
+		flags |= MAP_POPULATE;
+		effects_.populated = true;
+	}
+#endif
+
+	void* const p = ::mmap(
 		nullptr,
-		size_,
+		length,
 		PROT_READ,
-		MAP_PRIVATE,
+		flags,
 		fd,
-		0
+		static_cast<off_t>(offset)
 	);
-	if (data_ == MAP_FAILED) {
-		::close(fd);
+	if (p == MAP_FAILED) return nullptr;
+
+	::madvise(p, length, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+	if (huge_pages) {
+		effects_.huge_pages = ::madvise(p, length, MADV_HUGEPAGE) == 0;
+	}
+#endif
+	return p;
+}
+
+bool MemoryMapPosix::copy_file() noexcept {
+	constexpr std::size_t HUGE_PAGE = std::size_t{2} << 20;
+	const std::size_t length = (file_size_ + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+
+#ifdef MAP_HUGETLB
+	copy = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (copy != MAP_FAILED) {
+		copy_size = length;
+		data_ = copy;
+		effects_.hugetlb = true;
+		effects_.huge_pages = true;
+	}
+#endif
+
+	if (!effects_.hugetlb) {
+		// No reserved huge pages. Transparent huge pages need 2 MB alignment, so take one
+		// more huge page than needed and start the copy on the first boundary in it.
+		copy_size = length + HUGE_PAGE;
+		copy = ::mmap(nullptr, copy_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (copy == MAP_FAILED) {
+			copy = nullptr;
+			return false;
+		}
+		void* aligned = copy;
+		std::size_t space = copy_size;
+		data_ = std::align(HUGE_PAGE, length, aligned, space);
+#ifdef MADV_HUGEPAGE
+		effects_.huge_pages = ::madvise(data_, length, MADV_HUGEPAGE) == 0;
+#endif
+	}
+
+	std::uint8_t* const dst = static_cast<std::uint8_t*>(data_);
+	std::size_t done = 0;
+	while (done < file_size_) {
+		const ssize_t n = ::pread(fd, dst + done, file_size_ - done, static_cast<off_t>(done));
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) {
+			::munmap(copy, copy_size);
+			copy = nullptr;
+			data_ = nullptr;
+			return false;
+		}
+		done += static_cast<std::size_t>(n);
+	}
+
+	::mprotect(data_, length, PROT_READ);
+	effects_.copied = true;
+	return true;
+}
+
+void MemoryMapPosix::slide(const std::size_t file_offset) {
+	if (window == 0) return;
+
+	const std::size_t off = file_offset - file_offset % granularity;
+	const std::size_t len = std::min(window, file_size_ - off);
+	void* const view = map_range(off, len);
+	if (!view)
 		throw std::runtime_error("MemoryMapPosix error: mmap failed");
+
+	if (prev_data) ::munmap(prev_data, prev_size);
+	prev_data = data_;
+	prev_size = size_;
+	data_ = view;
+	size_ = len;
+	offset_ = off;
+}
+
+void MemoryMapPosix::will_need(std::size_t offset, std::size_t length) const noexcept {
+	if (copy) return;
+	if (!page_range(offset, length, file_size_, granularity)) return;
+	if (window == 0) {
+		::madvise(static_cast<std::uint8_t*>(data_) + offset, length, MADV_WILLNEED);
+		return;
 	}
+	// With a window, the range is usually not mapped yet (and the mapping may be sliding on
+	// another thread), so go through the file instead.
+#ifndef __APPLE__
+	::posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_WILLNEED);
+#endif
+}
 
-	::madvise(data_, size_, MADV_SEQUENTIAL);
+void MemoryMapPosix::dont_need(std::size_t offset, std::size_t length) const noexcept {
+	if (copy) return; // Anonymous memory would be zeroed, not dropped.
+	if (!page_range(offset, length, file_size_, granularity)) return;
+	// MADV_DONTNEED only unmaps the pages from this process; the fadvise evicts them from the
+	// page cache too, unless another process has them mapped. With a window, past windows are
+	// unmapped by slide() already.
+	if (window == 0) {
+		::madvise(static_cast<std::uint8_t*>(data_) + offset, length, MADV_DONTNEED);
+	}
+#ifndef __APPLE__
+	::posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+#endif
 }
 
 MemoryMapPosix::~MemoryMapPosix() {
-	if (data_ && data_ != MAP_FAILED)
+	if (prev_data)
+		::munmap(prev_data, prev_size);
+	if (copy)
+		::munmap(copy, copy_size);
+	else if (data_)
 		::munmap(data_, size_);
 	if (fd != -1)
 		::close(fd);
@@ -0,0 +1,58 @@
+#include "itch/mmap/read_ahead.hpp"
+#include "itch/mmap/mmap.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+
+namespace itch::mmap {
+
+ReadAhead::ReadAhead(const MemoryMap& m, const ReadAheadWindow w)
+: map(m)
+, window(w)
+{
+	if (window.step == 0)
+		throw std::runtime_error("ReadAhead error: step must be non-zero");
+
+	worker = std::thread(&ReadAhead::run, this);
+}
+
+ReadAhead::~ReadAhead() {
+	publish(STOP);
+	worker.join();
+}
+
+void ReadAhead::run() noexcept {
+	const std::size_t size = map.file_size();
+	std::size_t advised_to = 0;
+	std::size_t dropped_to = 0;
+
+	for (;;) {
+		const std::size_t pos = position.load(std::memory_order_acquire);
+		if (pos == STOP) return;
+
+		// One step at a time, so the part the reader needs first is requested first.
+		const std::size_t ahead_to = std::min(pos + window.ahead, size);
+		while (advised_to < ahead_to) {
+			const std::size_t length = std::min(window.step, ahead_to - advised_to);
+			map.will_need(advised_to, length);
+			advised_to += length;
+			advised.store(advised_to, std::memory_order_relaxed);
+		}
+
+		if (window.drop_behind && pos > window.keep_behind) {
+			const std::size_t drop_to = (pos - window.keep_behind) / window.step * window.step;
+			if (drop_to > dropped_to) {
+				map.dont_need(dropped_to, drop_to - dropped_to);
+				dropped_to = drop_to;
+				dropped.store(dropped_to, std::memory_order_relaxed);
+			}
+		}
+
+		position.wait(pos, std::memory_order_acquire);
+	}
+}
+
+} // namespace itch::mmap
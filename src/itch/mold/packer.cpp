@@ -0,0 +1,64 @@
+#include "itch/mold/packer.hpp"
+#include "itch/util/util.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
+namespace itch::mold {
+
+Packer::Packer(
+	const std::string_view session,
+	const std::uint64_t first_sequence,
+	const std::size_t max_sz,
+	const std::uint16_t max_msgs
+)
+: max_size(max_sz)
+, max_messages(max_msgs)
+, buffer(std::max<std::size_t>(max_sz, HEADER_SIZE + 2 + 0xFFFF), ' ')
+, sequence(first_sequence)
+{
+	if (max_size < HEADER_SIZE + 2 || max_messages == 0 || max_messages == END_OF_SESSION)
+		throw std::invalid_argument("Packer error: max_size or max_messages is out of range");
+
+	std::copy_n(session.begin(), std::min(session.size(), SESSION_SIZE), buffer.begin());
+}
+
+bool Packer::fits(const std::size_t len) const noexcept {
+	return count < max_messages && used + 2 + len <= max_size;
+}
+
+void Packer::add(const std::uint8_t* const msg, const std::uint16_t len) noexcept {
+	util::write_be(buffer.data() + used, len);
+	std::memcpy(buffer.data() + used + 2, msg, len);
+	used += 2 + len;
+	++count;
+}
+
+std::span<const std::uint8_t> Packer::flush() noexcept {
+	const auto packet = header(count).subspan(0, used);
+	sequence += count;
+	used = HEADER_SIZE;
+	count = 0;
+	return packet;
+}
+
+std::span<const std::uint8_t> Packer::heartbeat() noexcept {
+	return header(0).subspan(0, HEADER_SIZE);
+}
+
+std::span<const std::uint8_t> Packer::end_of_session() noexcept {
+	return header(END_OF_SESSION).subspan(0, HEADER_SIZE);
+}
+
+std::span<const std::uint8_t> Packer::header(const std::uint16_t message_count) noexcept {
+	util::write_be(buffer.data() + SESSION_SIZE, sequence);
+	util::write_be(buffer.data() + SESSION_SIZE + 8, message_count);
+	return buffer;
+}
+
+} // namespace itch::mold
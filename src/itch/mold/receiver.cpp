@@ -0,0 +1,201 @@
+#include "itch/mold/receiver.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace itch::mold {
+
+#ifdef _WIN32
+struct Receiver::Batch {};
+
+Receiver::Receiver(const ReceiverOptions& options)
+: packet_size(options.packet_size)
+, timeout_ms(options.timeout_ms)
+, busy_poll(options.busy_poll)
+{
+	throw std::runtime_error("Receiver error: only available on POSIX systems");
+}
+
+Receiver::~Receiver() = default;
+
+std::span<const std::span<const std::uint8_t>> Receiver::receive() {
+	return {};
+}
+
+std::span<const std::span<const std::uint8_t>> Receiver::receive_queued() {
+	return {};
+}
+
+bool wait_any(std::span<Receiver* const>, int) {
+	return false;
+}
+#else
+struct Receiver::Batch {
+	std::vector<iovec> iovecs;
+#ifdef __linux__
+	std::vector<mmsghdr> headers;
+#endif // __linux__
+};
+
+namespace {
+
+in_addr parse_address(const std::string& address) {
+	in_addr addr{};
+	if (::inet_pton(AF_INET, address.c_str(), &addr) != 1)
+		throw std::runtime_error("Receiver error: bad IPv4 address " + address);
+	return addr;
+}
+
+} // namespace
+
+Receiver::Receiver(const ReceiverOptions& options)
+: packet_size(options.packet_size)
+, timeout_ms(options.timeout_ms)
+, busy_poll(options.busy_poll)
+, batch(std::make_unique<Batch>())
+{
+	if (options.batch == 0 || options.packet_size < HEADER_SIZE)
+		throw std::runtime_error("Receiver error: batch and packet_size are too small");
+
+	const in_addr group = parse_address(options.address);
+	const bool is_multicast = IN_MULTICAST(ntohl(group.s_addr));
+
+	fd_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd_ < 0)
+		throw std::runtime_error("Receiver error: could not create a socket");
+
+	// Close the socket if anything below throws.
+	std::unique_ptr<int, void (*)(int*)> guard(&fd_, [](int* fd) { ::close(*fd); *fd = -1; });
+
+	const int one = 1;
+	::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	// Best effort: the kernel caps it at net.core.rmem_max.
+	::setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &options.receive_buffer, sizeof(options.receive_buffer));
+
+	if (!busy_poll && timeout_ms >= 0) {
+		timeval tv{};
+		tv.tv_sec = timeout_ms / 1000;
+		tv.tv_usec = (timeout_ms % 1000) * 1000;
+		::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	}
+
+	sockaddr_in local{};
+	local.sin_family = AF_INET;
+	local.sin_port = htons(options.port);
+	local.sin_addr = group;
+	if (::bind(fd_, static_cast<const sockaddr*>(static_cast<const void*>(&local)), sizeof(local)) != 0)
+		throw std::runtime_error("Receiver error: could not bind " + options.address + ":" + std::to_string(options.port));
+
+	socklen_t len = sizeof(local);
+	::getsockname(fd_, static_cast<sockaddr*>(static_cast<void*>(&local)), &len);
+	port_ = ntohs(local.sin_port);
+
+	if (is_multicast) {
+		ip_mreq request{};
+		request.imr_multiaddr = group;
+		request.imr_interface = parse_address(options.interface);
+		if (::setsockopt(fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) != 0)
+			throw std::runtime_error("Receiver error: could not join " + options.address);
+	}
+
+	buffers = std::make_unique_for_overwrite<std::uint8_t[]>(options.batch * packet_size);
+	packets.resize(options.batch);
+	batch->iovecs.resize(options.batch);
+	for (unsigned i = 0; i < options.batch; ++i) {
+		batch->iovecs[i].iov_base = buffers.get() + i * packet_size;
+		batch->iovecs[i].iov_len = packet_size;
+	}
+#ifdef __linux__
+	batch->headers.resize(options.batch);
+	for (unsigned i = 0; i < options.batch; ++i) {
+		batch->headers[i] = {};
+		batch->headers[i].msg_hdr.msg_iov = &batch->iovecs[i];
+		batch->headers[i].msg_hdr.msg_iovlen = 1;
+	}
+#endif // __linux__
+
+	guard.release();
+}
+
+Receiver::~Receiver() {
+	if (fd_ >= 0) ::close(fd_);
+}
+
+unsigned Receiver::take(const bool wait) {
+	const unsigned capacity = static_cast<unsigned>(packets.size());
+#ifdef __linux__
+	// MSG_WAITFORONE: block for the first packet only, then take what's queued.
+	const int got = ::recvmmsg(fd_, batch->headers.data(), capacity, wait ? MSG_WAITFORONE : MSG_DONTWAIT, nullptr);
+	if (got <= 0) return 0;
+	for (unsigned i = 0; i < static_cast<unsigned>(got); ++i) {
+		packets[i] = {buffers.get() + i * packet_size, batch->headers[i].msg_len};
+	}
+	return static_cast<unsigned>(got);
+#else
+	unsigned n = 0;
+	while (n < capacity) {
+		const ssize_t got = ::recv(fd_, batch->iovecs[n].iov_base, packet_size, n == 0 && wait ? 0 : MSG_DONTWAIT);
+		if (got < 0) break;
+		packets[n] = {buffers.get() + n * packet_size, static_cast<std::size_t>(got)};
+		++n;
+	}
+	return n;
+#endif // __linux__
+}
+
+std::span<const std::span<const std::uint8_t>> Receiver::receive() {
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+	for (std::uint64_t spins = 0;; ++spins) {
+		const unsigned n = take(!busy_poll);
+		if (n != 0) return {packets.data(), n};
+
+		if (errno == EINTR) return {};
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			throw std::runtime_error("Receiver error: receive failed");
+		if (!busy_poll) return {}; // SO_RCVTIMEO ran out.
+		if (timeout_ms >= 0 && spins % 1024 == 0 && std::chrono::steady_clock::now() >= deadline) return {};
+	}
+}
+
+std::span<const std::span<const std::uint8_t>> Receiver::receive_queued() {
+	const unsigned n = take(false);
+	if (n == 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+		throw std::runtime_error("Receiver error: receive failed");
+	return {packets.data(), n};
+}
+
+bool wait_any(const std::span<Receiver* const> receivers, const int timeout_ms) {
+	pollfd fds[8];
+	if (receivers.size() > std::size(fds))
+		throw std::runtime_error("Receiver error: wait_any takes at most 8 receivers");
+
+	for (std::size_t i = 0; i < receivers.size(); ++i) {
+		fds[i] = {receivers[i]->fd(), POLLIN, 0};
+	}
+	const int ready = ::poll(fds, static_cast<nfds_t>(receivers.size()), timeout_ms);
+	if (ready < 0 && errno != EINTR)
+		throw std::runtime_error("Receiver error: poll failed");
+	return ready > 0;
+}
+#endif // _WIN32
+
+} // namespace itch::mold
@@ -0,0 +1,120 @@
+#include "itch/mold/replay.hpp"
+#include "itch/parser.hpp"
+#include "itch/util/util.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace itch::mold {
+
+namespace {
+
+// Messages are only walked and copied into packets, never dispatched.
+struct NoHandler {};
+
+using Clock = std::chrono::steady_clock;
+
+// Sleeps through most of the wait and spins the rest, since a sleep can overshoot by tens of
+// microseconds.
+void wait_until(const Clock::time_point due) {
+	constexpr auto SPIN = std::chrono::microseconds(200);
+	const auto now = Clock::now();
+	if (due - now > SPIN) {
+		std::this_thread::sleep_for(due - now - SPIN);
+	}
+	while (Clock::now() < due) {/*spin*/}
+}
+
+} // namespace
+
+Replayer::Replayer(const std::string& path, ReplayOptions opts)
+: filepath(path)
+, options(std::move(opts))
+{/*no-op*/}
+
+ReplayStats Replayer::run() {
+	NoHandler none;
+	Parser<NoHandler> parser(filepath, none);
+	Packer packer(options.session, options.first_sequence, options.max_packet_size, options.max_messages);
+	Sender sender(options.destination);
+
+	const bool is_paced = options.speed > 0;
+	const std::size_t batch = is_paced ? 1 : std::max<std::size_t>(options.batch, 1);
+
+	// A packet waits here for the rest of its batch, since the packer reuses its buffer.
+	std::vector<std::vector<std::uint8_t>> slots(batch);
+	std::vector<std::span<const std::uint8_t>> waiting;
+	waiting.reserve(batch);
+
+	ReplayStats stats;
+	const auto start = Clock::now();
+	std::uint64_t first_ts = 0;
+	std::uint64_t packet_ts = 0;
+
+	const auto send_batch = [&] {
+		if (!waiting.empty()) sender.send(waiting);
+		waiting.clear();
+	};
+
+	const auto send_packet = [&](const std::span<const std::uint8_t> packet) {
+		++stats.packets;
+		if (options.drop_one_in != 0 && stats.packets % options.drop_one_in == 0) {
+			++stats.dropped;
+			return;
+		}
+		stats.bytes += packet.size();
+
+		if (is_paced) {
+			const auto due = start + std::chrono::nanoseconds(
+				static_cast<std::int64_t>(static_cast<double>(packet_ts - first_ts) / options.speed));
+			wait_until(due);
+			const auto late = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - due);
+			stats.max_late_ns = std::max(stats.max_late_ns, static_cast<std::uint64_t>(late.count()));
+			sender.send(packet);
+		} else {
+			auto& slot = slots[waiting.size()];
+			slot.assign(packet.begin(), packet.end());
+			waiting.emplace_back(slot);
+			if (waiting.size() == batch) send_batch();
+		}
+	};
+
+	while (!stopping.load(std::memory_order_relaxed) && parser.next()) {
+		const std::uint8_t* const msg = parser.message();
+		const auto len = util::read_be<std::uint16_t>(msg - 2);
+		const std::uint64_t ts = util::read_be_u48(msg + 5);
+		if (stats.messages == 0) first_ts = ts;
+
+		if (!packer.empty() &&
+		    (!packer.fits(len) || (is_paced && ts > packet_ts + options.max_delay_ns))) {
+			send_packet(packer.flush());
+		}
+		if (packer.empty()) packet_ts = std::max(ts, first_ts);
+
+		packer.add(msg, len);
+		++stats.messages;
+	}
+
+	if (!stopping.load(std::memory_order_relaxed)) {
+		if (!packer.empty()) send_packet(packer.flush());
+		send_batch();
+		if (options.end_of_session) {
+			const auto packet = packer.end_of_session();
+			++stats.packets;
+			stats.bytes += packet.size();
+			sender.send(packet);
+		}
+	}
+
+	stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	return stats;
+}
+
+} // namespace itch::mold
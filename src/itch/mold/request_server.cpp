@@ -0,0 +1,127 @@
+#include "itch/mold/request_server.hpp"
+#include "itch/util/util.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace itch::mold {
+
+#ifdef _WIN32
+RequestServer::RequestServer(const std::string& filepath, const RequestServerOptions& opts)
+: options(opts)
+, mapping(filepath)
+{
+	throw std::runtime_error("RequestServer error: only available on POSIX systems");
+}
+
+RequestServer::~RequestServer() = default;
+
+std::uint64_t RequestServer::run() {
+	return 0;
+}
+#else
+RequestServer::RequestServer(const std::string& filepath, const RequestServerOptions& opts)
+: options(opts)
+, mapping(filepath)
+, messages(index::MessageIndex::build(mapping.data(), mapping.size(), STRIDE, index::MESSAGES))
+{
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(options.port);
+	if (::inet_pton(AF_INET, options.address.c_str(), &addr.sin_addr) != 1)
+		throw std::runtime_error("RequestServer error: bad IPv4 address " + options.address);
+
+	fd_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd_ < 0)
+		throw std::runtime_error("RequestServer error: could not create a socket");
+
+	// Wakes run() now and then to check for stop().
+	const timeval timeout{0, 100'000};
+	::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	socklen_t len = sizeof(addr);
+	if (::bind(fd_, static_cast<const sockaddr*>(static_cast<const void*>(&addr)), sizeof(addr)) != 0 ||
+	    ::getsockname(fd_, static_cast<sockaddr*>(static_cast<void*>(&addr)), &len) != 0) {
+		::close(fd_);
+		throw std::runtime_error("RequestServer error: could not bind " + options.address);
+	}
+	port_ = ntohs(addr.sin_port);
+}
+
+RequestServer::~RequestServer() {
+	if (fd_ >= 0) ::close(fd_);
+}
+
+std::uint64_t RequestServer::run() {
+	// Compared as the packer writes it: padded or cut to SESSION_SIZE.
+	std::string session(SESSION_SIZE, ' ');
+	std::copy_n(options.session.begin(), std::min(options.session.size(), SESSION_SIZE), session.begin());
+
+	const std::uint64_t first_sequence = options.first_sequence;
+	const std::uint64_t end_sequence = first_sequence + messages.message_count();
+	std::uint64_t answered = 0;
+
+	std::uint8_t request[REQUEST_SIZE + 1];
+	while (!stopping.load(std::memory_order_relaxed)) {
+		sockaddr_in from{};
+		socklen_t from_len = sizeof(from);
+		const ssize_t got = ::recvfrom(fd_, request, sizeof(request), 0,
+		                               static_cast<sockaddr*>(static_cast<void*>(&from)), &from_len);
+		if (got < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) continue;
+			throw std::runtime_error("RequestServer error: receive failed");
+		}
+
+		const PacketView header(request);
+		if (static_cast<std::size_t>(got) != REQUEST_SIZE || header.session() != session) continue;
+
+		const std::uint64_t first = std::max(header.sequence(), first_sequence);
+		const std::uint64_t end = std::min(header.sequence() + header.count(), end_sequence);
+		if (first >= end) continue;
+
+		// From the checkpoint at or before the first message, walk to it.
+		const std::uint64_t n = first - first_sequence;
+		std::uint64_t pos = messages.offsets()[n / STRIDE];
+		for (std::uint64_t i = n / STRIDE * STRIDE; i < n; ++i) {
+			pos += 2 + util::read_be<std::uint16_t>(mapping.data() + pos);
+		}
+
+		const auto* const to = static_cast<const sockaddr*>(static_cast<const void*>(&from));
+		const auto send = [&](const std::span<const std::uint8_t> packet) {
+			while (::sendto(fd_, packet.data(), packet.size(), 0, to, from_len) < 0) {
+				if (errno != EINTR && errno != ENOBUFS && errno != EAGAIN && errno != EWOULDBLOCK)
+					throw std::runtime_error("RequestServer error: send failed");
+			}
+		};
+
+		Packer packer(options.session, first, options.max_packet_size);
+		for (std::uint64_t seq = first; seq < end; ++seq) {
+			const std::uint8_t* const msg = mapping.data() + pos + 2;
+			const auto len = util::read_be<std::uint16_t>(msg - 2);
+			if (!packer.empty() && !packer.fits(len)) send(packer.flush());
+			packer.add(msg, len);
+			pos += 2 + len;
+		}
+		send(packer.flush());
+		++answered;
+	}
+
+	return answered;
+}
+#endif // _WIN32
+
+} // namespace itch::mold
@@ -0,0 +1,140 @@
+#include "itch/mold/sender.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace itch::mold {
+
+#ifdef _WIN32
+struct Sender::Destination {};
+
+Sender::Sender(const SenderOptions&) {
+	throw std::runtime_error("Sender error: only available on POSIX systems");
+}
+
+Sender::~Sender() = default;
+
+void Sender::send(std::span<const std::uint8_t>) {}
+
+void Sender::send(std::span<const std::span<const std::uint8_t>>) {}
+#else
+struct Sender::Destination {
+	sockaddr_in addr{};
+	std::vector<iovec> iovecs;
+#ifdef __linux__
+	std::vector<mmsghdr> headers;
+#endif // __linux__
+};
+
+namespace {
+
+in_addr parse_address(const std::string& address) {
+	in_addr addr{};
+	if (::inet_pton(AF_INET, address.c_str(), &addr) != 1)
+		throw std::runtime_error("Sender error: bad IPv4 address " + address);
+	return addr;
+}
+
+// Retries what the kernel had no room for; those calls fail with ENOBUFS or EAGAIN.
+bool should_retry() noexcept {
+	return errno == EINTR || errno == ENOBUFS || errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+} // namespace
+
+Sender::Sender(const SenderOptions& options)
+: destination(std::make_unique<Destination>())
+{
+	destination->addr.sin_family = AF_INET;
+	destination->addr.sin_port = htons(options.port);
+	destination->addr.sin_addr = parse_address(options.address);
+	// Sized for one packet up front, so sending one never allocates.
+	destination->iovecs.resize(1);
+#ifdef __linux__
+	destination->headers.resize(1);
+#endif // __linux__
+
+	is_owned = options.fd < 0;
+	fd_ = is_owned ? ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0) : options.fd;
+	if (fd_ < 0)
+		throw std::runtime_error("Sender error: could not create a socket");
+	if (!is_owned) return; // Left as its owner set it up.
+
+	::setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &options.send_buffer, sizeof(options.send_buffer));
+
+	if (IN_MULTICAST(ntohl(destination->addr.sin_addr.s_addr))) {
+		const in_addr interface = parse_address(options.interface);
+		const unsigned char ttl = static_cast<unsigned char>(std::clamp(options.ttl, 0, 255));
+		const unsigned char loop = 1;
+		if (::setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface)) != 0 ||
+		    ::setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) != 0 ||
+		    ::setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) != 0) {
+			::close(fd_);
+			throw std::runtime_error("Sender error: could not set up multicast on " + options.interface);
+		}
+	}
+}
+
+Sender::~Sender() {
+	if (is_owned && fd_ >= 0) ::close(fd_);
+}
+
+void Sender::send(const std::span<const std::uint8_t> packet) {
+	const std::span<const std::uint8_t> one[] = {packet};
+	send(one);
+}
+
+void Sender::send(const std::span<const std::span<const std::uint8_t>> packets) {
+	Destination& d = *destination;
+
+#ifdef __linux__
+	if (d.headers.size() < packets.size()) {
+		d.iovecs.resize(packets.size());
+		d.headers.resize(packets.size());
+	}
+	for (std::size_t i = 0; i < packets.size(); ++i) {
+		d.iovecs[i].iov_base = const_cast<std::uint8_t*>(packets[i].data()); // Not written to.
+		d.iovecs[i].iov_len = packets[i].size();
+		d.headers[i] = {};
+		d.headers[i].msg_hdr.msg_name = &d.addr;
+		d.headers[i].msg_hdr.msg_namelen = sizeof(d.addr);
+		d.headers[i].msg_hdr.msg_iov = &d.iovecs[i];
+		d.headers[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	for (std::size_t sent = 0; sent < packets.size();) {
+		const int n = ::sendmmsg(fd_, d.headers.data() + sent, static_cast<unsigned>(packets.size() - sent), 0);
+		if (n > 0) {
+			sent += static_cast<std::size_t>(n);
+		} else if (!should_retry()) {
+			throw std::runtime_error("Sender error: send failed");
+		}
+	}
+#else
+	const auto* const to = static_cast<const sockaddr*>(static_cast<const void*>(&d.addr));
+	for (const auto packet : packets) {
+		while (::sendto(fd_, packet.data(), packet.size(), 0, to, sizeof(d.addr)) < 0) {
+			if (!should_retry())
+				throw std::runtime_error("Sender error: send failed");
+		}
+	}
+#endif // __linux__
+}
+#endif // _WIN32
+
+} // namespace itch::mold
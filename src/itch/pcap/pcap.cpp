@@ -0,0 +1,403 @@
+#include "itch/pcap/pcap.hpp"
+#include "itch/util/util.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+namespace itch::pcap {
+
+namespace {
+
+constexpr std::uint32_t PCAP_MAGIC = 0xA1B2C3D4;     // Microsecond timestamps.
+constexpr std::uint32_t PCAP_MAGIC_NS = 0xA1B23C4D;  // Nanosecond timestamps.
+constexpr std::size_t PCAP_HEADER_SIZE = 24;
+constexpr std::size_t PCAP_RECORD_SIZE = 16;
+
+constexpr std::uint32_t SECTION_HEADER = 0x0A0D0D0A;
+constexpr std::uint32_t BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+constexpr std::uint32_t INTERFACE_DESCRIPTION = 1;
+constexpr std::uint32_t PACKET = 2;                  // Obsolete, but still written by some tools.
+constexpr std::uint32_t SIMPLE_PACKET = 3;
+constexpr std::uint32_t ENHANCED_PACKET = 6;
+
+constexpr std::uint16_t OPTION_END = 0;
+constexpr std::uint16_t IF_TSRESOL = 9;
+constexpr std::uint16_t IF_TSOFFSET = 14;
+
+constexpr std::uint16_t ETHERTYPE_IPV4 = 0x0800;
+constexpr std::uint16_t ETHERTYPE_IPV6 = 0x86DD;
+constexpr std::uint8_t UDP_PROTOCOL = 17;
+
+[[nodiscard]] std::uint32_t read_native32(const std::uint8_t* p) noexcept {
+	std::uint32_t value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+[[nodiscard]] std::size_t padded(const std::size_t size) noexcept {
+	return (size + 3) & ~std::size_t{3};
+}
+
+// A timestamp in units of the given if_tsresol, in ns.
+[[nodiscard]] std::uint64_t to_ns(const std::uint64_t ts, const std::uint8_t resolution, const std::int64_t offset) noexcept {
+	constexpr std::uint64_t NS = 1'000'000'000;
+	std::uint64_t ns;
+	if (resolution & 0x80) {
+		const unsigned shift = resolution & 0x7F;
+		if (shift >= 64) return 0;
+		const std::uint64_t fraction = ts & ((std::uint64_t{1} << shift) - 1);
+		ns = (ts >> shift) * NS + (shift <= 32 ? (fraction * NS) >> shift : 0);
+	} else {
+		std::uint64_t scale = 1;
+		for (unsigned i = 0; i < (resolution > 9 ? resolution - 9u : 9u - resolution) && i < 20; ++i) {
+			scale *= 10;
+		}
+		ns = resolution <= 9 ? ts * scale : ts / scale;
+	}
+	return ns + static_cast<std::uint64_t>(offset) * NS;
+}
+
+} // namespace
+
+bool parse_udp(const Frame& frame, Datagram& datagram) noexcept {
+	const std::uint8_t* p = frame.data.data();
+	const std::uint8_t* end = p + frame.data.size();
+	std::uint16_t ether_type = 0;
+
+	switch (frame.link_type) {
+	case LINK_ETHERNET:
+		if (end - p < 14) return false;
+		ether_type = util::read_be<std::uint16_t>(p + 12);
+		p += 14;
+		while (ether_type == 0x8100 || ether_type == 0x88A8 || ether_type == 0x9100) {
+			if (end - p < 4) return false;
+			ether_type = util::read_be<std::uint16_t>(p + 2);
+			p += 4;
+		}
+		break;
+	case LINK_LINUX_SLL:
+		if (end - p < 16) return false;
+		ether_type = util::read_be<std::uint16_t>(p + 14);
+		p += 16;
+		break;
+	case LINK_LINUX_SLL2:
+		if (end - p < 20) return false;
+		ether_type = util::read_be<std::uint16_t>(p);
+		p += 20;
+		break;
+	case LINK_NULL: {
+		// The family is in the byte order of the machine that wrote the capture.
+		if (end - p < 4) return false;
+		const std::uint32_t family = p[0] != 0 ? p[0] : p[3];
+		ether_type = family == 2 ? ETHERTYPE_IPV4 : (family == 24 || family == 28 || family == 30) ? ETHERTYPE_IPV6 : 0;
+		p += 4;
+		break;
+	}
+	case LINK_RAW:
+		if (end - p < 1) return false;
+		ether_type = (p[0] >> 4) == 4 ? ETHERTYPE_IPV4 : (p[0] >> 4) == 6 ? ETHERTYPE_IPV6 : 0;
+		break;
+	case LINK_IPV4:
+		ether_type = ETHERTYPE_IPV4;
+		break;
+	case LINK_IPV6:
+		ether_type = ETHERTYPE_IPV6;
+		break;
+	default:
+		return false;
+	}
+
+	if (ether_type == ETHERTYPE_IPV4) {
+		if (end - p < 20 || (p[0] >> 4) != 4) return false;
+		const std::size_t header_size = (p[0] & 0x0F) * 4u;
+		const std::size_t total_size = util::read_be<std::uint16_t>(p + 2);
+		if (header_size < 20 || total_size < header_size || static_cast<std::size_t>(end - p) < total_size) return false;
+		if ((util::read_be<std::uint16_t>(p + 6) & 0x3FFF) != 0) return false; // A fragment.
+		if (p[9] != UDP_PROTOCOL) return false;
+
+		datagram.source = util::read_be<std::uint32_t>(p + 12);
+		datagram.destination = util::read_be<std::uint32_t>(p + 16);
+		end = p + total_size; // Drops the Ethernet padding of short frames.
+		p += header_size;
+	} else if (ether_type == ETHERTYPE_IPV6) {
+		if (end - p < 40 || (p[0] >> 4) != 6) return false;
+		const std::size_t payload_size = util::read_be<std::uint16_t>(p + 4);
+		if (static_cast<std::size_t>(end - p) - 40 < payload_size) return false;
+		std::uint8_t next_header = p[6];
+		end = p + 40 + payload_size;
+		p += 40;
+
+		// Hop-by-hop, routing and destination options headers; a fragment header ends it.
+		while (next_header == 0 || next_header == 43 || next_header == 60) {
+			if (end - p < 8) return false;
+			const std::size_t size = (p[1] + 1u) * 8u;
+			if (static_cast<std::size_t>(end - p) < size) return false;
+			next_header = p[0];
+			p += size;
+		}
+		if (next_header != UDP_PROTOCOL) return false;
+
+		datagram.source = 0;
+		datagram.destination = 0;
+	} else {
+		return false;
+	}
+
+	if (end - p < 8) return false;
+	const std::size_t udp_size = util::read_be<std::uint16_t>(p + 4);
+	if (udp_size < 8 || static_cast<std::size_t>(end - p) < udp_size) return false;
+
+	datagram.source_port = util::read_be<std::uint16_t>(p);
+	datagram.destination_port = util::read_be<std::uint16_t>(p + 2);
+	datagram.payload = {p + 8, udp_size - 8};
+	return true;
+}
+
+Capture::Capture(const std::string& filepath, const mmap::MapOptions& map_options)
+: map(filepath, map_options)
+, ptr(map.data())
+, end(map.data() + map.size())
+{
+	if (map_options.window != 0)
+		throw std::runtime_error("Capture error: a capture is mapped whole, not in a window");
+	if (map.size() < 4)
+		throw std::runtime_error("Capture error: " + filepath + " is not a pcap or pcapng file");
+
+	const std::uint32_t magic = read_native32(ptr);
+	if (magic == SECTION_HEADER) {
+		is_ng = true; // The section header sets the byte order, and is read by next().
+		return;
+	}
+
+	if (magic == PCAP_MAGIC || magic == PCAP_MAGIC_NS) {
+		is_swapped = false;
+	} else if (magic == util::byte_swap_u32(PCAP_MAGIC) || magic == util::byte_swap_u32(PCAP_MAGIC_NS)) {
+		is_swapped = true;
+	} else {
+		throw std::runtime_error("Capture error: " + filepath + " is not a pcap or pcapng file");
+	}
+	if (map.size() < PCAP_HEADER_SIZE)
+		throw std::runtime_error("Capture error: " + filepath + " is cut short in its header");
+
+	Interface interface;
+	interface.link_type = static_cast<std::uint16_t>(read32(ptr + 20));
+	interface.resolution = read32(ptr) == PCAP_MAGIC_NS ? 9 : 6;
+	interfaces.push_back(interface);
+	ptr += PCAP_HEADER_SIZE;
+}
+
+std::uint16_t Capture::read16(const std::uint8_t* p) const noexcept {
+	std::uint16_t value;
+	std::memcpy(&value, p, sizeof(value));
+	return is_swapped ? util::byte_swap_u16(value) : value;
+}
+
+std::uint32_t Capture::read32(const std::uint8_t* p) const noexcept {
+	const std::uint32_t value = read_native32(p);
+	return is_swapped ? util::byte_swap_u32(value) : value;
+}
+
+bool Capture::next(Frame& frame) {
+	return is_ng ? nextPcapng(frame) : nextPcap(frame);
+}
+
+bool Capture::nextPcap(Frame& frame) {
+	if (ptr == end) return false;
+	if (static_cast<std::size_t>(end - ptr) < PCAP_RECORD_SIZE)
+		throw std::runtime_error("Capture error: a record header runs past the end of the file");
+
+	const std::uint32_t captured = read32(ptr + 8);
+	if (static_cast<std::size_t>(end - ptr) - PCAP_RECORD_SIZE < captured)
+		throw std::runtime_error("Capture error: a record runs past the end of the file");
+
+	const Interface& interface = interfaces.front();
+	frame.timestamp = std::uint64_t{read32(ptr)} * 1'000'000'000 +
+		read32(ptr + 4) * (interface.resolution == 9 ? 1u : 1000u);
+	frame.link_type = interface.link_type;
+	frame.original_size = read32(ptr + 12);
+	frame.data = {ptr + PCAP_RECORD_SIZE, captured};
+	ptr += PCAP_RECORD_SIZE + captured;
+	return true;
+}
+
+void Capture::readInterface(const std::uint8_t* body, const std::size_t size) {
+	if (size < 8)
+		throw std::runtime_error("Capture error: interface description block is too short");
+
+	Interface interface;
+	interface.link_type = read16(body);
+
+	const std::uint8_t* option = body + 8;
+	const std::uint8_t* const options_end = body + size;
+	while (options_end - option >= 4) {
+		const std::uint16_t code = read16(option);
+		const std::size_t length = read16(option + 2);
+		if (code == OPTION_END || static_cast<std::size_t>(options_end - option) - 4 < length) break;
+
+		if (code == IF_TSRESOL && length >= 1) {
+			interface.resolution = option[4];
+		} else if (code == IF_TSOFFSET && length >= 8) {
+			std::uint64_t value;
+			std::memcpy(&value, option + 4, sizeof(value));
+			interface.offset = static_cast<std::int64_t>(is_swapped ? util::byte_swap_u64(value) : value);
+		}
+		option += 4 + padded(length);
+	}
+
+	interfaces.push_back(interface);
+}
+
+bool Capture::nextPcapng(Frame& frame) {
+	while (ptr != end) {
+		if (end - ptr < 12)
+			throw std::runtime_error("Capture error: a block header runs past the end of the file");
+
+		const std::uint32_t type = read_native32(ptr); // Same in both byte orders for a section.
+		if (type == SECTION_HEADER) {
+			const std::uint32_t order = read_native32(ptr + 8);
+			if (order == BYTE_ORDER_MAGIC) {
+				is_swapped = false;
+			} else if (order == util::byte_swap_u32(BYTE_ORDER_MAGIC)) {
+				is_swapped = true;
+			} else {
+				throw std::runtime_error("Capture error: bad byte-order magic in a section header");
+			}
+			interfaces.clear(); // Interface ids are per section.
+		}
+
+		const std::size_t size = read32(ptr + 4);
+		if (size < 12 || size % 4 != 0 || static_cast<std::size_t>(end - ptr) < size)
+			throw std::runtime_error("Capture error: a block runs past the end of the file");
+
+		const std::uint8_t* const block = ptr;
+		const std::uint8_t* const body = ptr + 8;
+		const std::size_t body_size = size - 12;
+		ptr += size;
+
+		switch (type == SECTION_HEADER ? 0 : read32(block)) {
+		case INTERFACE_DESCRIPTION:
+			readInterface(body, body_size);
+			break;
+		case ENHANCED_PACKET:
+		case PACKET: {
+			if (body_size < 20)
+				throw std::runtime_error("Capture error: packet block is too short");
+			const bool is_enhanced = read32(block) == ENHANCED_PACKET;
+			const std::uint32_t id = is_enhanced ? read32(body) : read16(body);
+			const std::uint32_t captured = read32(body + 12);
+			if (id >= interfaces.size() || body_size - 20 < captured)
+				throw std::runtime_error("Capture error: bad packet block");
+
+			const Interface& interface = interfaces[id];
+			const std::uint64_t ts = std::uint64_t{read32(body + 4)} << 32 | read32(body + 8);
+			frame.timestamp = to_ns(ts, interface.resolution, interface.offset);
+			frame.link_type = interface.link_type;
+			frame.original_size = read32(body + 16);
+			frame.data = {body + 20, captured};
+			return true;
+		}
+		case SIMPLE_PACKET: {
+			if (body_size < 4 || interfaces.empty())
+				throw std::runtime_error("Capture error: bad simple packet block");
+			frame.timestamp = 0;
+			frame.link_type = interfaces.front().link_type;
+			frame.original_size = read32(body);
+			frame.data = {body + 4, std::min<std::size_t>(frame.original_size, body_size - 4)};
+			return true;
+		}
+		default:
+			break; // Statistics, name resolution, custom blocks...
+		}
+	}
+	return false;
+}
+
+Writer::Writer(const std::string& filepath, const LinkType link, const std::uint32_t snap_length)
+: file(std::fopen(filepath.c_str(), "wb"), &std::fclose)
+, link_type(link)
+{
+	if (!file)
+		throw std::runtime_error("Writer error: could not open " + filepath);
+
+	// Written in this machine's byte order, which the magic number tells readers.
+	const std::uint32_t header[6] = {PCAP_MAGIC_NS, 0x00040002, 0, 0, snap_length, link};
+	if (std::fwrite(header, sizeof(header), 1, file.get()) != 1)
+		throw std::runtime_error("Writer error: could not write to " + filepath);
+}
+
+void Writer::write(const std::uint64_t timestamp, const std::span<const std::uint8_t> data) {
+	const std::uint32_t record[4] = {
+		static_cast<std::uint32_t>(timestamp / 1'000'000'000),
+		static_cast<std::uint32_t>(timestamp % 1'000'000'000),
+		static_cast<std::uint32_t>(data.size()),
+		static_cast<std::uint32_t>(data.size())
+	};
+	if (std::fwrite(record, sizeof(record), 1, file.get()) != 1 ||
+	    std::fwrite(data.data(), 1, data.size(), file.get()) != data.size())
+		throw std::runtime_error("Writer error: write failed");
+}
+
+void Writer::write_udp(const std::uint64_t timestamp, const Datagram& datagram) {
+	if (link_type != LINK_ETHERNET && link_type != LINK_RAW && link_type != LINK_IPV4)
+		throw std::runtime_error("Writer error: write_udp() needs an Ethernet or IPv4 link type");
+
+	const std::size_t link_size = link_type == LINK_ETHERNET ? 14 : 0;
+	const std::size_t ip_size = 20 + 8 + datagram.payload.size();
+	if (ip_size > 0xFFFF)
+		throw std::runtime_error("Writer error: payload too long for a UDP datagram");
+	frame.assign(link_size + ip_size, 0);
+
+	std::uint8_t* p = frame.data();
+	const auto put16 = [](std::uint8_t* at, const std::uint32_t value) {
+		at[0] = static_cast<std::uint8_t>(value >> 8);
+		at[1] = static_cast<std::uint8_t>(value);
+	};
+	const auto put32 = [&put16](std::uint8_t* at, const std::uint32_t value) {
+		put16(at, value >> 16);
+		put16(at + 2, value);
+	};
+
+	if (link_type == LINK_ETHERNET) {
+		if ((datagram.destination >> 28) == 0xE) {
+			// 01:00:5e and the low 23 bits of the group.
+			put32(p, 0x01005E00 | ((datagram.destination >> 16) & 0x7F));
+			put16(p + 4, datagram.destination);
+		}
+		put16(p + 12, ETHERTYPE_IPV4);
+		p += 14;
+	}
+
+	p[0] = 0x45;
+	put16(p + 2, static_cast<std::uint32_t>(ip_size));
+	p[8] = 1; // TTL
+	p[9] = UDP_PROTOCOL;
+	put32(p + 12, datagram.source);
+	put32(p + 16, datagram.destination);
+	std::uint32_t sum = 0;
+	for (std::size_t i = 0; i < 20; i += 2) {
+		sum += util::read_be<std::uint16_t>(p + i);
+	}
+	sum = (sum & 0xFFFF) + (sum >> 16);
+	sum = (sum & 0xFFFF) + (sum >> 16);
+	put16(p + 10, ~sum & 0xFFFF);
+	p += 20;
+
+	put16(p, datagram.source_port);
+	put16(p + 2, datagram.destination_port);
+	put16(p + 4, static_cast<std::uint32_t>(8 + datagram.payload.size())); // No checksum.
+	std::copy(datagram.payload.begin(), datagram.payload.end(), p + 8);
+
+	write(timestamp, frame);
+}
+
+void Writer::flush() {
+	if (std::fflush(file.get()) != 0)
+		throw std::runtime_error("Writer error: write failed");
+}
+
+} // namespace itch::pcap
@@ -0,0 +1,231 @@
+#include "itch/perf/perf.hpp"
+#include "itch/util/util.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // __linux__
+
+namespace itch::perf {
+
+namespace {
+
+#ifdef __linux__
+struct Config {
+	std::uint32_t type;
+	std::uint64_t config;
+};
+
+constexpr std::uint64_t cache_miss(const std::uint64_t cache) noexcept {
+	return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+constexpr std::array<Config, EVENTS> CONFIGS = {{
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+	{PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D)},
+	{PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL)},
+	{PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB)},
+}};
+
+// No glibc wrapper.
+int perf_event_open(perf_event_attr* const attr) noexcept {
+	return static_cast<int>(::syscall(__NR_perf_event_open, attr, 0, -1, -1, 0));
+}
+
+std::string why(const int err) {
+	switch (err) {
+		case ENOENT:
+		case EOPNOTSUPP: return "not supported by this CPU or VM";
+		case EACCES:
+		case EPERM: return "not permitted; see kernel.perf_event_paranoid";
+		case ENOSYS: return "perf_event_open is not available";
+		default: return std::strerror(err);
+	}
+}
+#endif // __linux__
+
+// "12.34", or "-" when the counter wasn't there.
+std::string per(const bool available, const std::uint64_t count, const std::uint64_t messages) {
+	if (!available) return "-";
+	char text[32];
+	std::snprintf(text, sizeof(text), "%.3f",
+		messages == 0 ? 0.0 : static_cast<double>(count) / static_cast<double>(messages));
+	return text;
+}
+
+void row(std::string& out, const char* label, const Profile& p, const Interval& i) {
+	const auto& c = i.reading.counts;
+	const bool has_ipc = p.available[CYCLES] && p.available[INSTRUCTIONS];
+	char ipc[32] = "-";
+	if (has_ipc) {
+		std::snprintf(ipc, sizeof(ipc), "%.2f",
+			c[CYCLES] == 0 ? 0.0 : static_cast<double>(c[INSTRUCTIONS]) / static_cast<double>(c[CYCLES]));
+	}
+
+	char line[256];
+	std::snprintf(line, sizeof(line), "%-10s %12llu %9s %10s %10s %6s %10s %10s %10s %10s\n",
+		label, static_cast<unsigned long long>(i.messages),
+		per(true, i.reading.ns, i.messages).c_str(),
+		per(p.available[CYCLES], c[CYCLES], i.messages).c_str(),
+		per(p.available[INSTRUCTIONS], c[INSTRUCTIONS], i.messages).c_str(),
+		ipc,
+		per(p.available[BRANCH_MISSES], c[BRANCH_MISSES], i.messages).c_str(),
+		per(p.available[L1D_MISSES], c[L1D_MISSES], i.messages).c_str(),
+		per(p.available[LLC_MISSES], c[LLC_MISSES], i.messages).c_str(),
+		per(p.available[DTLB_MISSES], c[DTLB_MISSES], i.messages).c_str());
+	out += line;
+}
+
+} // namespace
+
+const char* name(const Event event) noexcept {
+	switch (event) {
+		case CYCLES: return "cycles";
+		case INSTRUCTIONS: return "instructions";
+		case BRANCH_MISSES: return "branch-misses";
+		case L1D_MISSES: return "L1-dcache-load-misses";
+		case LLC_MISSES: return "LLC-load-misses";
+		case DTLB_MISSES: return "dTLB-load-misses";
+		default: return "(unknown)";
+	}
+}
+
+Reading operator-(const Reading& after, const Reading& before) noexcept {
+	Reading r;
+	for (std::size_t e = 0; e < EVENTS; ++e) {
+		// Scaled counts can step back a little as the kernel's estimate improves.
+		r.counts[e] = after.counts[e] > before.counts[e] ? after.counts[e] - before.counts[e] : 0;
+	}
+	r.ns = after.ns - before.ns;
+	return r;
+}
+
+#ifdef __linux__
+Counters::Counters() {
+	fds.fill(-1);
+	for (std::size_t e = 0; e < EVENTS; ++e) {
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = CONFIGS[e].type;
+		attr.config = CONFIGS[e].config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		fds[e] = perf_event_open(&attr);
+		if (fds[e] < 0 && reason.empty()) {
+			reason = std::string(name(static_cast<Event>(e))) + ": " + why(errno);
+		}
+	}
+}
+
+Counters::~Counters() {
+	for (const int fd : fds) {
+		if (fd >= 0) ::close(fd);
+	}
+}
+
+void Counters::start() noexcept {
+	for (const int fd : fds) {
+		if (fd < 0) continue;
+		::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+	started = std::chrono::steady_clock::now();
+}
+
+void Counters::stop() noexcept {
+	for (const int fd : fds) {
+		if (fd >= 0) ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+	}
+}
+
+Reading Counters::read() const noexcept {
+	Reading r;
+	for (std::size_t e = 0; e < EVENTS; ++e) {
+		if (fds[e] < 0) continue;
+		std::uint64_t values[3]; // value, time enabled, time running
+		if (::read(fds[e], values, sizeof(values)) != static_cast<ssize_t>(sizeof(values))) continue;
+		r.counts[e] = values[2] == 0 || values[2] == values[1]
+			? values[0]
+			: static_cast<std::uint64_t>(static_cast<double>(values[0]) * static_cast<double>(values[1]) / static_cast<double>(values[2]));
+	}
+	r.ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - started).count());
+	return r;
+}
+#else
+Counters::Counters()
+: reason("perf_event_open is only available on Linux")
+{
+	fds.fill(-1);
+}
+
+Counters::~Counters() = default;
+
+void Counters::start() noexcept {
+	started = std::chrono::steady_clock::now();
+}
+
+void Counters::stop() noexcept {/*no-op*/}
+
+Reading Counters::read() const noexcept {
+	Reading r;
+	r.ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - started).count());
+	return r;
+}
+#endif // __linux__
+
+std::string report(const Profile& profile) {
+	std::string out;
+
+	bool any = false;
+	std::string missing;
+	for (std::size_t e = 0; e < EVENTS; ++e) {
+		if (profile.available[e]) {
+			any = true;
+		} else {
+			missing += missing.empty() ? "" : ", ";
+			missing += name(static_cast<Event>(e));
+		}
+	}
+	if (!any) {
+		out += "no hardware counters (" + profile.error + "); time only\n";
+	} else if (!missing.empty()) {
+		out += "not counted: " + missing + " (" + profile.error + ")\n";
+	}
+
+	char line[256];
+	std::snprintf(line, sizeof(line), "%-10s %12s %9s %10s %10s %6s %10s %10s %10s %10s\n",
+		"interval", "messages", "ns/msg", "cycles", "instr", "IPC", "br-miss", "L1d-miss", "LLC-miss", "dTLB-miss");
+	out += line;
+
+	Interval total;
+	for (std::size_t i = 0; i < profile.intervals.size(); ++i) {
+		const Interval& interval = profile.intervals[i];
+		row(out, std::to_string(i).c_str(), profile, interval);
+		total.messages += interval.messages;
+		total.reading.ns += interval.reading.ns;
+		for (std::size_t e = 0; e < EVENTS; ++e) total.reading.counts[e] += interval.reading.counts[e];
+	}
+	row(out, "total", profile, total);
+	out += "(per message, but for messages and IPC)\n";
+	return out;
+}
+
+} // namespace itch::perf
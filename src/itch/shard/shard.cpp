@@ -0,0 +1,32 @@
+#include "itch/shard/shard.hpp"
+
+#include <cstddef>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif // _WIN32
+
+namespace itch::shard {
+
+bool pin_thread(std::thread& t, const std::size_t cpu) noexcept {
+#ifdef _WIN32
+	if (cpu >= 64) return false;
+	return SetThreadAffinityMask(t.native_handle(), DWORD_PTR{1} << cpu) != 0;
+#elif defined(__linux__)
+	if (cpu >= CPU_SETSIZE) return false;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return ::pthread_setaffinity_np(t.native_handle(), sizeof(set), &set) == 0;
+#else
+	(void)t;
+	(void)cpu;
+	return false;
+#endif // _WIN32
+}
+
+} // namespace itch::shard
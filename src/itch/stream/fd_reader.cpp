@@ -0,0 +1,88 @@
+#include "itch/stream/fd_reader.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace itch::stream {
+
+#ifdef _WIN32
+FdReader::FdReader(const std::string& path)
+: fd_(path == "-" ? 0 : _open(path.c_str(), _O_RDONLY | _O_BINARY | _O_SEQUENTIAL))
+, is_owned(path != "-")
+{
+	if (fd_ < 0)
+		throw std::runtime_error("FdReader error: could not open " + path);
+	if (!is_owned)
+		_setmode(fd_, _O_BINARY); // stdin is in text mode by default.
+}
+
+FdReader::FdReader(const int fd)
+: fd_(fd)
+, is_owned(false)
+{
+	if (fd_ < 0)
+		throw std::runtime_error("FdReader error: invalid file descriptor");
+	_setmode(fd_, _O_BINARY);
+}
+
+FdReader::~FdReader() {
+	if (is_owned) _close(fd_);
+}
+
+std::size_t FdReader::read(std::uint8_t* const buf, const std::size_t size) {
+	for (;;) {
+		const int n = _read(fd_, buf, static_cast<unsigned>(std::min<std::size_t>(size, INT_MAX)));
+		if (n >= 0) return static_cast<std::size_t>(n);
+		if (errno != EINTR)
+			throw std::runtime_error("FdReader error: read failed");
+	}
+}
+#else
+FdReader::FdReader(const std::string& path)
+: fd_(path == "-" ? STDIN_FILENO : ::open(path.c_str(), O_RDONLY | O_CLOEXEC))
+, is_owned(path != "-")
+{
+	if (fd_ < 0)
+		throw std::runtime_error("FdReader error: could not open " + path);
+#ifdef POSIX_FADV_SEQUENTIAL
+	// Doubles the kernel's read-ahead on regular files; fails harmlessly on pipes.
+	::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
+FdReader::FdReader(const int fd)
+: fd_(fd)
+, is_owned(false)
+{
+	if (fd_ < 0)
+		throw std::runtime_error("FdReader error: invalid file descriptor");
+}
+
+FdReader::~FdReader() {
+	if (is_owned) ::close(fd_);
+}
+
+std::size_t FdReader::read(std::uint8_t* const buf, const std::size_t size) {
+	for (;;) {
+		const ssize_t n = ::read(fd_, buf, std::min<std::size_t>(size, SSIZE_MAX));
+		if (n >= 0) return static_cast<std::size_t>(n);
+		if (errno != EINTR)
+			throw std::runtime_error("FdReader error: read failed");
+	}
+}
+#endif // _WIN32
+
+} // namespace itch::stream
@@ -0,0 +1,131 @@
+#include "itch/stream/stream.hpp"
+#include "itch/util/util.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace itch::stream {
+
+BlockStream::BlockStream(ReadFn r, const std::size_t size, const std::size_t count)
+: read(std::move(r))
+, block_size(size)
+{
+	if (block_size < HEADROOM)
+		throw std::runtime_error("BlockStream error: block_size must be at least 68 KB");
+	if (count < 2)
+		throw std::runtime_error("BlockStream error: block_count must be at least 2");
+
+	constexpr std::size_t ALIGNMENT = 4096;
+	blocks.resize(count);
+	for (Block& b : blocks) {
+		b.memory = std::make_unique_for_overwrite<std::uint8_t[]>(HEADROOM + block_size + ALIGNMENT);
+		void* data = b.memory.get() + HEADROOM;
+		std::size_t space = block_size + ALIGNMENT;
+		b.data = static_cast<std::uint8_t*>(std::align(ALIGNMENT, block_size, data, space));
+	}
+
+	reader = std::thread(&BlockStream::run, this);
+}
+
+BlockStream::~BlockStream() {
+	{
+		const std::lock_guard lock(mutex);
+		stopping = true;
+	}
+	freed_cv.notify_all();
+	reader.join();
+}
+
+std::span<const std::uint8_t> BlockStream::next() {
+	std::unique_lock lock(mutex);
+	if (taken > released) {
+		++released;
+		freed_cv.notify_one();
+	}
+
+	for (;;) {
+		filled_cv.wait(lock, [&] { return taken < filled || is_done; });
+		if (taken == filled) {
+			if (error) std::rethrow_exception(error);
+			return {};
+		}
+
+		const Block& b = blocks[taken++ % blocks.size()];
+		if (b.size != 0) {
+			return {b.data - b.carry, b.size};
+		}
+		// Nothing whole in it (only possible at the very end); skip it.
+		++released;
+		freed_cv.notify_one();
+	}
+}
+
+void BlockStream::run() noexcept {
+	std::vector<std::uint8_t> carry;
+	carry.reserve(HEADROOM);
+
+	try {
+		for (std::uint64_t i = 0;; ++i) {
+			{
+				std::unique_lock lock(mutex);
+				freed_cv.wait(lock, [&] { return stopping || i < released + blocks.size(); });
+				if (stopping) return;
+			}
+
+			Block& b = blocks[i % blocks.size()];
+			std::memcpy(b.data - carry.size(), carry.data(), carry.size());
+			b.carry = carry.size();
+
+			std::size_t n = 0;
+			bool is_eof = false;
+			while (n < block_size) {
+				const std::size_t got = read(b.data + n, block_size - n);
+				if (got == 0) {
+					is_eof = true;
+					break;
+				}
+				n += got;
+			}
+
+			// Find the end of the last whole message; what's after it is the next carry.
+			const std::uint8_t* ptr = b.data - b.carry;
+			const std::uint8_t* const end = b.data + n;
+			while (end - ptr >= 2) {
+				const std::size_t len = 2 + util::read_be<std::uint16_t>(ptr);
+				if (static_cast<std::size_t>(end - ptr) < len) break;
+				ptr += len;
+			}
+			b.size = static_cast<std::size_t>(ptr - (b.data - b.carry));
+			carry.assign(ptr, end);
+
+			if (is_eof && !carry.empty())
+				throw std::runtime_error("BlockStream error: input ends in the middle of a message");
+
+			{
+				const std::lock_guard lock(mutex);
+				++filled;
+				is_done = is_eof;
+			}
+			filled_cv.notify_one();
+			if (is_eof) return;
+		}
+	} catch (...) {
+		{
+			const std::lock_guard lock(mutex);
+			error = std::current_exception();
+			is_done = true;
+		}
+		filled_cv.notify_one();
+	}
+}
+
+} // namespace itch::stream
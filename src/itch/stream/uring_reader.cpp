@@ -0,0 +1,328 @@
+#include "itch/stream/uring_reader.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif // __linux__
+
+namespace itch::stream {
+
+#ifdef __linux__
+namespace {
+
+// O_DIRECT wants offsets, lengths and buffers aligned to the logical block size, which no
+// device makes bigger than a page.
+constexpr std::size_t ALIGNMENT = 4096;
+
+// No liburing, so the three syscalls are called directly.
+int uring_setup(const unsigned entries, io_uring_params* const params) noexcept {
+	return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int uring_enter(const int ring, const unsigned submit, const unsigned min_complete) noexcept {
+	const unsigned flags = min_complete != 0 ? IORING_ENTER_GETEVENTS : 0;
+	return static_cast<int>(::syscall(__NR_io_uring_enter, ring, submit, min_complete, flags, nullptr, 0));
+}
+
+int uring_register(const int ring, const unsigned opcode, const void* const arg, const unsigned count) noexcept {
+	return static_cast<int>(::syscall(__NR_io_uring_register, ring, opcode, arg, count));
+}
+
+// An mmap()ed region that is always unmapped.
+struct Mapping {
+	void* data = MAP_FAILED;
+	std::size_t size = 0;
+
+	Mapping() = default;
+
+	Mapping(const Mapping&) = delete;
+	Mapping& operator=(const Mapping&) = delete;
+
+	~Mapping() {
+		if (data != MAP_FAILED) ::munmap(data, size);
+	}
+
+	void map(const std::size_t sz, const int prot, const int flags, const int fd, const off_t offset) {
+		data = ::mmap(nullptr, sz, prot, flags, fd, offset);
+		size = sz;
+		if (data == MAP_FAILED)
+			throw std::runtime_error("UringReader error: mmap failed");
+	}
+
+	template <typename T>
+	[[nodiscard]] T* at(const std::size_t offset) const noexcept {
+		return static_cast<T*>(static_cast<void*>(static_cast<std::uint8_t*>(data) + offset));
+	}
+};
+
+} // namespace
+
+struct UringReader::State {
+	// Each slot owns one buffer and reads the chunks slot, slot + depth, slot + 2 * depth...
+	struct Slot {
+		std::size_t filled = 0; // Bytes of the current chunk read so far.
+		int error = 0;
+		bool in_flight = false;
+	};
+
+	int file = -1;
+	int ring = -1;
+	std::uint64_t file_size = 0;
+	std::size_t chunk_size;
+	unsigned depth;
+	bool registered = false;
+
+	Mapping sq_ring;
+	Mapping cq_ring; // Unused (sq_ring has both) with IORING_FEAT_SINGLE_MMAP.
+	Mapping sqes;
+	Mapping buffers;
+
+	std::uint32_t* sq_tail = nullptr;
+	std::uint32_t sq_mask = 0;
+	std::uint32_t* sq_array = nullptr;
+	io_uring_sqe* sqe_array = nullptr;
+	std::uint32_t* cq_head = nullptr;
+	std::uint32_t* cq_tail = nullptr;
+	std::uint32_t cq_mask = 0;
+	io_uring_cqe* cqe_array = nullptr;
+	unsigned to_submit = 0;
+
+	std::vector<Slot> slots;
+	std::uint64_t next_submit = 0; // Next chunk to start reading.
+	std::uint64_t next_read = 0;   // Chunk read() copies from.
+	std::size_t consumed = 0;      // Bytes of it already copied out.
+
+	State(const std::size_t chunk, const unsigned queue_depth)
+	: chunk_size(chunk)
+	, depth(queue_depth)
+	, slots(queue_depth)
+	{/*no-op*/}
+
+	State(const State&) = delete;
+	State& operator=(const State&) = delete;
+
+	// The kernel may still be writing into the buffers, so wait for it before they go.
+	~State() {
+		while (ring >= 0 && std::any_of(slots.begin(), slots.end(), [](const Slot& s) { return s.in_flight; })) {
+			if (uring_enter(ring, to_submit, 1) < 0 && errno != EINTR) break;
+			to_submit = 0;
+			reap(false);
+		}
+		if (ring >= 0) ::close(ring);
+		if (file >= 0) ::close(file);
+	}
+
+	[[nodiscard]] std::uint8_t* buffer(const unsigned slot) const noexcept {
+		return buffers.at<std::uint8_t>(slot * chunk_size);
+	}
+
+	[[nodiscard]] std::size_t chunk_length(const std::uint64_t chunk) const noexcept {
+		return static_cast<std::size_t>(std::min<std::uint64_t>(chunk_size, file_size - chunk * chunk_size));
+	}
+
+	// Queues a read of the rest of the given chunk; it goes to the kernel with the next enter.
+	void submit(const std::uint64_t chunk) noexcept {
+		const unsigned slot = static_cast<unsigned>(chunk % depth);
+		Slot& s = slots[slot];
+
+		const std::uint32_t tail = *sq_tail; // Only this thread writes it.
+		const std::uint32_t index = tail & sq_mask;
+		io_uring_sqe& sqe = sqe_array[index];
+		std::memset(&sqe, 0, sizeof(sqe));
+		sqe.opcode = registered ? IORING_OP_READ_FIXED : IORING_OP_READ;
+		sqe.fd = file;
+		sqe.addr = reinterpret_cast<std::uintptr_t>(buffer(slot) + s.filled); // The kernel ABI wants an integer.
+		sqe.len = static_cast<std::uint32_t>(chunk_size - s.filled); // Past the end is fine.
+		sqe.off = chunk * chunk_size + s.filled;
+		sqe.buf_index = static_cast<std::uint16_t>(slot);
+		sqe.user_data = chunk;
+		sq_array[index] = index;
+		std::atomic_ref(*sq_tail).store(tail + 1, std::memory_order_release);
+
+		s.in_flight = true;
+		++to_submit;
+	}
+
+	// Handles every completion there is. A short read is resumed where it stopped, unless
+	// resume is false (when shutting down).
+	void reap(const bool resume) noexcept {
+		std::uint32_t head = *cq_head;
+		const std::uint32_t tail = std::atomic_ref(*cq_tail).load(std::memory_order_acquire);
+
+		for (; head != tail; ++head) {
+			const io_uring_cqe& cqe = cqe_array[head & cq_mask];
+			const std::uint64_t chunk = cqe.user_data;
+			Slot& s = slots[chunk % depth];
+			s.in_flight = false;
+
+			if (cqe.res < 0) {
+				if (resume && (cqe.res == -EAGAIN || cqe.res == -EINTR)) {
+					submit(chunk);
+				} else {
+					s.error = -cqe.res;
+				}
+			} else if (cqe.res == 0 && s.filled < chunk_length(chunk)) {
+				s.error = ENODATA; // The file got shorter.
+			} else {
+				s.filled += static_cast<std::size_t>(cqe.res);
+				if (resume && s.filled < chunk_length(chunk)) submit(chunk);
+			}
+		}
+
+		std::atomic_ref(*cq_head).store(head, std::memory_order_release);
+	}
+
+	void start_next() noexcept {
+		if (next_submit * chunk_size < file_size) {
+			slots[next_submit % depth].filled = 0;
+			submit(next_submit++);
+		}
+	}
+};
+
+namespace {
+
+// Before State, which sizes its slots by queue_depth.
+const UringOptions& checked(const UringOptions& options) {
+	if (options.queue_depth == 0 || options.queue_depth > 4096)
+		throw std::runtime_error("UringReader error: queue_depth must be in [1, 4096]");
+	if (options.chunk_size == 0 || options.chunk_size % ALIGNMENT != 0 || options.chunk_size > (1u << 30))
+		throw std::runtime_error("UringReader error: chunk_size must be a multiple of 4 KB, up to 1 GB");
+	return options;
+}
+
+} // namespace
+
+UringReader::UringReader(const std::string& path, const UringOptions options)
+: state(std::make_unique<State>(checked(options).chunk_size, options.queue_depth))
+{
+	State& s = *state;
+
+	s.file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | (options.direct ? O_DIRECT : 0));
+	if (s.file < 0)
+		throw std::runtime_error(errno == EINVAL && options.direct
+			? "UringReader error: the filesystem doesn't support O_DIRECT"
+			: "UringReader error: could not open " + path);
+
+	struct stat st{};
+	if (::fstat(s.file, &st) != 0 || !S_ISREG(st.st_mode))
+		throw std::runtime_error("UringReader error: not a regular file");
+	s.file_size = static_cast<std::uint64_t>(st.st_size);
+
+	io_uring_params params{};
+	s.ring = uring_setup(options.queue_depth, &params);
+	if (s.ring < 0)
+		throw std::runtime_error("UringReader error: io_uring_setup failed");
+
+	std::size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(std::uint32_t);
+	std::size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (single) sq_size = cq_size = std::max(sq_size, cq_size);
+
+	constexpr int PROT = PROT_READ | PROT_WRITE;
+	constexpr int FLAGS = MAP_SHARED | MAP_POPULATE;
+	s.sq_ring.map(sq_size, PROT, FLAGS, s.ring, IORING_OFF_SQ_RING);
+	if (!single) {
+		s.cq_ring.map(cq_size, PROT, FLAGS, s.ring, IORING_OFF_CQ_RING);
+	}
+	s.sqes.map(params.sq_entries * sizeof(io_uring_sqe), PROT, FLAGS, s.ring, IORING_OFF_SQES);
+	s.buffers.map(s.chunk_size * s.depth, PROT, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	const Mapping& cq = single ? s.sq_ring : s.cq_ring;
+	s.sq_tail = s.sq_ring.at<std::uint32_t>(params.sq_off.tail);
+	s.sq_mask = *s.sq_ring.at<std::uint32_t>(params.sq_off.ring_mask);
+	s.sq_array = s.sq_ring.at<std::uint32_t>(params.sq_off.array);
+	s.sqe_array = s.sqes.at<io_uring_sqe>(0);
+	s.cq_head = cq.at<std::uint32_t>(params.cq_off.head);
+	s.cq_tail = cq.at<std::uint32_t>(params.cq_off.tail);
+	s.cq_mask = *cq.at<std::uint32_t>(params.cq_off.ring_mask);
+	s.cqe_array = cq.at<io_uring_cqe>(params.cq_off.cqes);
+
+	std::vector<iovec> iovecs(s.depth);
+	for (unsigned i = 0; i < s.depth; ++i) {
+		iovecs[i].iov_base = s.buffer(i);
+		iovecs[i].iov_len = s.chunk_size;
+	}
+	s.registered = uring_register(s.ring, IORING_REGISTER_BUFFERS, iovecs.data(), s.depth) == 0;
+
+	for (unsigned i = 0; i < s.depth; ++i) {
+		s.start_next();
+	}
+}
+
+UringReader::~UringReader() = default;
+
+std::size_t UringReader::read(std::uint8_t* const buf, const std::size_t size) {
+	State& s = *state;
+	std::size_t copied = 0;
+
+	while (copied < size && s.next_read * s.chunk_size < s.file_size) {
+		State::Slot& slot = s.slots[s.next_read % s.depth];
+		while (slot.in_flight) {
+			if (uring_enter(s.ring, s.to_submit, 1) < 0) {
+				if (errno == EINTR) continue;
+				throw std::runtime_error("UringReader error: io_uring_enter failed");
+			}
+			s.to_submit = 0;
+			s.reap(true);
+		}
+		if (slot.error != 0)
+			throw std::runtime_error("UringReader error: read failed: " + std::string(std::strerror(slot.error)));
+
+		const std::size_t length = s.chunk_length(s.next_read);
+		const std::size_t n = std::min(size - copied, length - s.consumed);
+		std::memcpy(buf + copied, s.buffer(static_cast<unsigned>(s.next_read % s.depth)) + s.consumed, n);
+		copied += n;
+		s.consumed += n;
+
+		if (s.consumed == length) {
+			s.consumed = 0;
+			++s.next_read;
+			s.start_next(); // Reuses the slot just emptied.
+		}
+	}
+
+	if (s.to_submit != 0 && uring_enter(s.ring, s.to_submit, 0) >= 0) {
+		s.to_submit = 0;
+	}
+	return copied;
+}
+
+bool UringReader::is_registered() const noexcept {
+	return state->registered;
+}
+#else
+struct UringReader::State {};
+
+UringReader::UringReader(const std::string&, const UringOptions) {
+	throw std::runtime_error("UringReader error: io_uring is only available on Linux");
+}
+
+UringReader::~UringReader() = default;
+
+std::size_t UringReader::read(std::uint8_t*, std::size_t) {
+	return 0;
+}
+
+bool UringReader::is_registered() const noexcept {
+	return false;
+}
+#endif // __linux__
+
+} // namespace itch::stream
@@ -0,0 +1,460 @@
+#include "itch/synth/synth.hpp"
+#include "itch/spec/encode.hpp"
+#include "itch/spec/messages.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace itch::synth {
+
+namespace {
+
+constexpr std::uint64_t NS_PER_HOUR = 3'600'000'000'000;
+constexpr std::uint64_t DAY_START = 4 * NS_PER_HOUR;
+constexpr std::uint64_t MARKET_OPEN = 9 * NS_PER_HOUR + NS_PER_HOUR / 2;
+constexpr std::uint64_t MARKET_CLOSE = 16 * NS_PER_HOUR;
+constexpr std::uint64_t DAY_END = 20 * NS_PER_HOUR;
+
+constexpr std::uint32_t TICK = 100;        // One cent, at four decimals.
+constexpr std::size_t RECENT = 64;         // Orders of a symbol most order messages pick from.
+constexpr std::uint32_t NO_REASON = 0x20202020; // Four spaces.
+
+// Four-character market participant ids, as the big-endian numbers the views read them as.
+constexpr std::uint32_t MPIDS[] = {
+	0x4E534451, // NSDQ
+	0x4753434F, // GSCO
+	0x4D53434F, // MSCO
+	0x55425353, // UBSS
+	0x43445247, // CDRG
+	0x56495254, // VIRT
+};
+
+[[nodiscard]] std::uint64_t splitmix64(std::uint64_t& x) noexcept {
+	std::uint64_t z = (x += 0x9E3779B97F4A7C15);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+	return z ^ (z >> 31);
+}
+
+[[nodiscard]] std::uint64_t rotl(const std::uint64_t x, const int k) noexcept {
+	return (x << k) | (x >> (64 - k));
+}
+
+// "A", "B", ..., "Z", "AA", ... padded with spaces to 8 characters.
+[[nodiscard]] std::uint64_t stock_name(std::uint32_t n) noexcept {
+	char name[8] = {' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '};
+	char letters[8];
+	int len = 0;
+	for (++n; n > 0 && len < 8; n = (n - 1) / 26) {
+		letters[len++] = static_cast<char>('A' + (n - 1) % 26);
+	}
+	for (int i = 0; i < len; ++i) {
+		name[i] = letters[len - 1 - i];
+	}
+
+	std::uint64_t value = 0;
+	for (const char c : name) {
+		value = (value << 8) | static_cast<std::uint8_t>(c);
+	}
+	return value;
+}
+
+// Turns weights into the odds and aliases of Walker's alias method. Slots start at weight 1
+// on average; those below 1 are topped up from those above.
+void build_alias(std::vector<double>& odds, std::vector<std::uint32_t>& alias) {
+	const auto n = static_cast<std::uint32_t>(odds.size());
+	double sum = 0;
+	for (const double w : odds) {
+		sum += w;
+	}
+
+	alias.resize(n);
+	std::vector<std::uint32_t> small, large;
+	for (std::uint32_t i = 0; i < n; ++i) {
+		odds[i] *= n / sum;
+		alias[i] = i;
+		(odds[i] < 1.0 ? small : large).push_back(i);
+	}
+	while (!small.empty() && !large.empty()) {
+		const std::uint32_t s = small.back();
+		const std::uint32_t l = large.back();
+		small.pop_back();
+		alias[s] = l;
+		odds[l] -= 1.0 - odds[s];
+		if (odds[l] < 1.0) {
+			large.pop_back();
+			small.push_back(l);
+		}
+	}
+	// What's left is 1 but for rounding.
+	for (const std::uint32_t i : small) odds[i] = 1.0;
+	for (const std::uint32_t i : large) odds[i] = 1.0;
+}
+
+} // namespace
+
+Mix default_mix() noexcept {
+	Mix mix{};
+	mix['A'] = 41.5;
+	mix['D'] = 40.5;
+	mix['U'] = 8.5;
+	mix['E'] = 2.5;
+	mix['X'] = 1.5;
+	mix['I'] = 0.9;
+	mix['P'] = 0.6;
+	mix['F'] = 0.5;
+	mix['N'] = 0.3;
+	mix['C'] = 0.1;
+	mix['L'] = 0.1;
+	mix['Q'] = 0.04;
+	mix['Y'] = 0.02;
+	mix['B'] = 0.01;
+	mix['H'] = 0.01;
+	mix['h'] = 0.005;
+	mix['K'] = 0.005;
+	mix['J'] = 0.005;
+	mix['O'] = 0.005;
+	return mix;
+}
+
+Generator::Generator(const GeneratorOptions& opts)
+: options(opts)
+, body_begin(2 + 2 * static_cast<std::uint64_t>(opts.symbols))
+, body_end(opts.messages - 2)
+, ns_per_message(static_cast<double>(DAY_END - DAY_START) / static_cast<double>(body_end - body_begin))
+{
+	if (options.symbols == 0 || options.symbols > 0xFFFF)
+		throw std::invalid_argument("Generator error: symbols must be in [1, 65535]");
+	if (options.messages < body_begin + 2)
+		throw std::invalid_argument("Generator error: messages can't hold the directory of every symbol");
+
+	std::uint64_t seed = options.seed;
+	for (auto& s : state) {
+		s = splitmix64(seed);
+	}
+
+	for (std::size_t i = 0; i < options.mix.size(); ++i) {
+		if (i == 'S' || i == 'R' || spec::MESSAGE_LENGTH[i] == 0 || !(options.mix[i] > 0))
+			continue;
+		types.push_back(static_cast<std::uint8_t>(i));
+		type_table.odds.push_back(options.mix[i]);
+	}
+	if (types.empty())
+		throw std::invalid_argument("Generator error: mix gives no message type a weight");
+	build_alias(type_table.odds, type_table.alias);
+
+	names.resize(options.symbols);
+	prices.resize(options.symbols);
+	books.resize(options.symbols);
+	symbol_table.odds.resize(options.symbols);
+	for (std::uint32_t i = 0; i < options.symbols; ++i) {
+		names[i] = stock_name(i);
+		// Anywhere from $1 to $1000, spread evenly over the decades.
+		constexpr std::uint32_t decades[] = {1, 10, 100};
+		prices[i] = decades[below(3)] * (10'000 + below(90'000));
+		symbol_table.odds[i] = 1.0 / std::pow(static_cast<double>(i + 1), options.skew);
+	}
+	build_alias(symbol_table.odds, symbol_table.alias);
+}
+
+std::uint64_t Generator::random() noexcept {
+	const std::uint64_t result = rotl(state[1] * 5, 7) * 9;
+	const std::uint64_t t = state[1] << 17;
+	state[2] ^= state[0];
+	state[3] ^= state[1];
+	state[1] ^= state[2];
+	state[0] ^= state[3];
+	state[2] ^= t;
+	state[3] = rotl(state[3], 45);
+	return result;
+}
+
+std::uint32_t Generator::below(const std::uint32_t n) noexcept {
+	return static_cast<std::uint32_t>(((random() >> 32) * n) >> 32);
+}
+
+std::uint32_t Generator::draw(const Alias& table) noexcept {
+	const std::uint32_t slot = below(static_cast<std::uint32_t>(table.odds.size()));
+	const double u = static_cast<double>(static_cast<std::int64_t>(random() >> 11)) * 0x1.0p-53;
+	return u < table.odds[slot] ? slot : table.alias[slot];
+}
+
+// Within 20 ticks of price, and at least one tick.
+std::uint32_t Generator::near(const std::uint32_t price) noexcept {
+	const std::uint32_t offset = below(41) * TICK;
+	return std::max(TICK, price + offset - std::min(price, 20 * TICK));
+}
+
+// Round lots, and one odd lot in eight.
+std::uint32_t Generator::lot() noexcept {
+	if (below(8) == 0)
+		return 1 + below(99);
+	return 100 * (1 + below(10));
+}
+
+std::size_t Generator::next(std::uint8_t* const out) {
+	if (count == options.messages)
+		return 0;
+	const std::uint64_t n = count++;
+
+	if (n < body_begin) {
+		timestamp = DAY_START;
+		return prologue(n, out);
+	}
+
+	if (n >= body_end) {
+		timestamp = DAY_END;
+		return spec::encode(spec::SystemEvent{timestamp, 0, 0, n == body_end ? std::uint8_t{'E'} : std::uint8_t{'C'}}, out);
+	}
+
+	const double offset = static_cast<double>(static_cast<std::int64_t>(n - body_begin)) * ns_per_message;
+	timestamp = DAY_START + static_cast<std::uint64_t>(static_cast<std::int64_t>(offset));
+
+	if (!is_market_open && timestamp >= MARKET_OPEN) {
+		is_market_open = true;
+		return spec::encode(spec::SystemEvent{timestamp, 0, 0, 'Q'}, out);
+	}
+	if (!is_market_closed && timestamp >= MARKET_CLOSE) {
+		is_market_closed = true;
+		return spec::encode(spec::SystemEvent{timestamp, 0, 0, 'M'}, out);
+	}
+
+	return body(out);
+}
+
+std::size_t Generator::prologue(const std::uint64_t n, std::uint8_t* const out) {
+	const std::uint64_t symbols = options.symbols;
+
+	if (n == 0)
+		return spec::encode(spec::SystemEvent{timestamp, 0, 0, 'O'}, out);
+	if (n == body_begin - 1)
+		return spec::encode(spec::SystemEvent{timestamp, 0, 0, 'S'}, out);
+
+	const auto i = static_cast<std::uint32_t>((n - 1) % symbols);
+	const auto locate = static_cast<std::uint16_t>(i + 1);
+
+	if (n <= symbols) {
+		return spec::encode(spec::StockDirectory{
+			.timestamp = timestamp,
+			.stock = names[i],
+			.round_lot_size = 100,
+			.etp_leverage_factor = 0,
+			.stock_locate = locate,
+			.tracking_number = 0,
+			.issue_subtype = 0x5A20, // "Z "
+			.market_category = 'Q',
+			.financial_status = 'N',
+			.is_round_lots_only = 'N',
+			.issue_classification = 'C',
+			.authenticity = 'P',
+			.short_sale_threshold = 'N',
+			.is_ipo = 'N',
+			.luld_ref_price_tier = prices[i] >= 30'000 ? std::uint8_t{'1'} : std::uint8_t{'2'},
+			.is_etp = 'N',
+			.is_inverse_etp = 'N'
+		}, out);
+	}
+
+	return spec::encode(spec::StockTradingAction{timestamp, names[i], NO_REASON, locate, 0, 'T', ' '}, out);
+}
+
+std::size_t Generator::add(const std::uint32_t sym, const bool with_mpid, std::uint8_t* const out) {
+	const Order order{
+		next_order++,
+		lot(),
+		near(prices[sym]),
+		below(2) == 0 ? std::uint8_t{'B'} : std::uint8_t{'S'}
+	};
+	books[sym].push_back(order);
+	++live;
+
+	const auto locate = static_cast<std::uint16_t>(sym + 1);
+	if (with_mpid) {
+		const std::uint32_t mpid = MPIDS[below(std::size(MPIDS))];
+		return spec::encode(spec::AddOrderWithMPID{
+			timestamp, order.id, names[sym], order.shares, order.price, mpid, locate, 0, order.side
+		}, out);
+	}
+	return spec::encode(spec::AddOrder{
+		timestamp, order.id, names[sym], order.shares, order.price, locate, 0, order.side
+	}, out);
+}
+
+std::size_t Generator::body(std::uint8_t* const out) {
+	std::uint8_t type = types[draw(type_table)];
+
+	const std::uint32_t sym = draw(symbol_table);
+	const auto locate = static_cast<std::uint16_t>(sym + 1);
+	const std::uint64_t stock = names[sym];
+	const std::uint32_t price = prices[sym];
+
+	// Messages about a live order pick one of the symbol's, or add one if it has none. As on a
+	// real feed, most hit one of the latest orders. A cancel leaves at least a share, so one of
+	// a single share is a delete.
+	auto& book = books[sym];
+	std::size_t pick = 0;
+	if (type == 'E' || type == 'C' || type == 'X' || type == 'D' || type == 'U') {
+		if (book.empty())
+			return add(sym, false, out);
+		const std::size_t span = below(4) == 0 ? book.size() : std::min(book.size(), RECENT);
+		pick = book.size() - 1 - below(static_cast<std::uint32_t>(span));
+		if (type == 'X' && book[pick].shares < 2)
+			type = 'D';
+	}
+	const auto remove = [&] {
+		book[pick] = book.back();
+		book.pop_back();
+		--live;
+	};
+
+	switch (type) {
+	case 'A':
+		return add(sym, false, out);
+	case 'F':
+		return add(sym, true, out);
+	case 'E':
+	case 'C': {
+		Order& order = book[pick];
+		const std::uint32_t shares = 1 + below(order.shares);
+		const spec::ExecuteOrderWithPrice m{timestamp, order.id, next_match++, shares, near(order.price), locate, 0, 'Y'};
+		order.shares -= shares;
+		if (order.shares == 0)
+			remove();
+		if (type == 'C')
+			return spec::encode(m, out);
+		return spec::encode(spec::ExecuteOrder{m.timestamp, m.order_id, m.match_number, m.executed_shares, 0, locate, 0}, out);
+	}
+	case 'X': {
+		Order& order = book[pick];
+		const std::uint32_t shares = 1 + below(order.shares - 1);
+		order.shares -= shares;
+		return spec::encode(spec::CancelOrder{timestamp, order.id, shares, locate, 0}, out);
+	}
+	case 'D': {
+		const std::size_t size = spec::encode(spec::DeleteOrder{timestamp, book[pick].id, locate, 0}, out);
+		remove();
+		return size;
+	}
+	case 'U': {
+		Order& order = book[pick];
+		const std::uint64_t old_id = order.id;
+		order.id = next_order++;
+		order.shares = lot();
+		order.price = near(order.price);
+		return spec::encode(spec::ReplaceOrder{timestamp, old_id, order.id, order.shares, order.price, locate, 0}, out);
+	}
+	case 'P':
+		return spec::encode(spec::NonCrossTrade{timestamp, 0, stock, next_match++, lot(), near(price), locate, 0, 'B'}, out);
+	case 'Q': {
+		const std::uint8_t cross = !is_market_open ? 'O' : !is_market_closed ? 'H' : 'C';
+		return spec::encode(spec::CrossTrade{timestamp, 100ull * lot(), stock, next_match++, price, locate, 0, cross}, out);
+	}
+	case 'B':
+		if (next_match == 1)
+			return add(sym, false, out);
+		// One of the last million trades.
+		return spec::encode(spec::BrokenTrade{
+			timestamp, next_match - 1 - below(static_cast<std::uint32_t>(std::min<std::uint64_t>(next_match - 1, 1'000'000))), locate, 0
+		}, out);
+	case 'I': {
+		constexpr std::uint8_t directions[] = {'B', 'S', 'N', 'O'};
+		const std::uint8_t cross = is_market_open ? 'C' : 'O';
+		return spec::encode(spec::NetOrderImbalance{
+			timestamp, 100ull * lot(), lot(), stock, near(price), near(price), price, locate, 0,
+			directions[below(4)], cross, ' '
+		}, out);
+	}
+	case 'N': {
+		constexpr std::uint8_t interests[] = {'B', 'S', 'A', 'N'};
+		return spec::encode(spec::RetailPriceImprovement{timestamp, stock, locate, 0, interests[below(4)]}, out);
+	}
+	case 'L':
+		return spec::encode(spec::MarketParticipantPosition{
+			timestamp, stock, MPIDS[below(std::size(MPIDS))], locate, 0,
+			below(4) == 0 ? std::uint8_t{'Y'} : std::uint8_t{'N'}, 'N', 'A'
+		}, out);
+	case 'Y':
+		return spec::encode(spec::RegSHORestriction{timestamp, stock, locate, 0, static_cast<std::uint8_t>('0' + below(3))}, out);
+	case 'H':
+		return spec::encode(spec::StockTradingAction{timestamp, stock, NO_REASON, locate, 0, 'T', ' '}, out);
+	case 'h':
+		return spec::encode(spec::OperationalHalt{timestamp, stock, locate, 0, 'Q', 'T'}, out);
+	case 'K':
+		return spec::encode(spec::IPOQuotingPeriodUpdate{
+			timestamp, stock, static_cast<std::uint32_t>(timestamp / 1'000'000'000), price, locate, 0, 'A'
+		}, out);
+	case 'J':
+		return spec::encode(spec::LULDAuctionCollar{
+			timestamp, stock, price, price + price / 20, price - price / 20, below(4), locate, 0
+		}, out);
+	case 'O':
+		return spec::encode(spec::DLCRPriceDiscovery{
+			timestamp, stock, timestamp, price - price / 10, price + price / 10, near(price),
+			price - price / 20, price + price / 20, locate, 0, 'Y'
+		}, out);
+	case 'V': {
+		constexpr std::uint64_t level = 3'000'00000000; // $3000, at eight decimals.
+		return spec::encode(spec::MWCBDeclineLevel{timestamp, level * 93 / 100, level * 87 / 100, level * 80 / 100, 0, 0}, out);
+	}
+	case 'W':
+		return spec::encode(spec::MWCBStatus{timestamp, 0, 0, '1'}, out);
+	default:
+		return add(sym, false, out);
+	}
+}
+
+std::vector<std::uint8_t> generate(const GeneratorOptions& options) {
+	Generator generator(options);
+	// Sized once for the default mix, which averages under 31 bytes a message.
+	std::vector<std::uint8_t> day(options.messages * 32 + spec::MAX_ENCODED_SIZE);
+	std::size_t used = 0;
+
+	for (;;) {
+		if (day.size() < used + spec::MAX_ENCODED_SIZE)
+			day.resize(2 * day.size());
+		const std::size_t size = generator.next(day.data() + used);
+		if (size == 0)
+			break;
+		used += size;
+	}
+
+	day.resize(used);
+	return day;
+}
+
+std::uint64_t write_file(const std::string& filepath, const GeneratorOptions& options) {
+	const std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(filepath.c_str(), "wb"), &std::fclose);
+	if (!file)
+		throw std::runtime_error("Generator error: could not open " + filepath);
+
+	Generator generator(options);
+	std::vector<std::uint8_t> buffer(1 << 20);
+	std::uint64_t total = 0;
+	std::size_t used = 0;
+
+	for (;;) {
+		const std::size_t size = generator.next(buffer.data() + used);
+		used += size;
+		if (size == 0 || used + spec::MAX_ENCODED_SIZE > buffer.size()) {
+			if (std::fwrite(buffer.data(), 1, used, file.get()) != used)
+				throw std::runtime_error("Generator error: could not write to " + filepath);
+			total += used;
+			used = 0;
+		}
+		if (size == 0)
+			break;
+	}
+
+	if (std::fflush(file.get()) != 0)
+		throw std::runtime_error("Generator error: could not write to " + filepath);
+	return total;
+}
+
+} // namespace itch::synth
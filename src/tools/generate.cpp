@@ -0,0 +1,86 @@
+// Writes a synthetic ITCH day. Usage:
+//   tv_itch50_cpp_generate <output> [--messages N] [--symbols N] [--seed N] [--skew X]
+//                          [--mix A=41.5,D=40.5,...]
+// --mix replaces the default weights of the types it names, and keeps the rest.
+
+#include "itch/synth/synth.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <string_view>
+
+namespace {
+
+void usage() {
+	std::fprintf(stderr,
+		"usage: tv_itch50_cpp_generate <output> [--messages N] [--symbols N] [--seed N] [--skew X]\n"
+		"                              [--mix A=41.5,D=40.5,...]\n");
+}
+
+// "A=41.5,D=40.5" sets mix['A'] and mix['D'].
+bool parse_mix(std::string_view text, itch::synth::Mix& mix) {
+	while (!text.empty()) {
+		const auto comma = text.find(',');
+		const std::string_view item = text.substr(0, comma);
+		if (item.size() < 3 || item[1] != '=')
+			return false;
+		mix[static_cast<unsigned char>(item[0])] = std::strtod(std::string(item.substr(2)).c_str(), nullptr);
+		text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+	}
+	return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	itch::synth::GeneratorOptions options;
+	std::string output;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string_view arg = argv[i];
+		const char* const value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (arg.starts_with("--") && value == nullptr) {
+			usage();
+			return 2;
+		}
+		if (arg == "--messages") {
+			options.messages = std::strtoull(value, nullptr, 10);
+		} else if (arg == "--symbols") {
+			options.symbols = static_cast<std::uint32_t>(std::strtoul(value, nullptr, 10));
+		} else if (arg == "--seed") {
+			options.seed = std::strtoull(value, nullptr, 10);
+		} else if (arg == "--skew") {
+			options.skew = std::strtod(value, nullptr);
+		} else if (arg == "--mix") {
+			if (!parse_mix(value, options.mix)) {
+				usage();
+				return 2;
+			}
+		} else if (!arg.starts_with("--") && output.empty()) {
+			output = arg;
+			continue;
+		} else {
+			usage();
+			return 2;
+		}
+		++i;
+	}
+
+	if (output.empty()) {
+		usage();
+		return 2;
+	}
+
+	try {
+		const std::uint64_t bytes = itch::synth::write_file(output, options);
+		std::printf("%s: %llu messages, %llu bytes\n", output.c_str(),
+			static_cast<unsigned long long>(options.messages), static_cast<unsigned long long>(bytes));
+	} catch (const std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,131 @@
+// Parses a file under hardware performance counters, and prints them per interval of
+// messages. Usage:
+//   tv_itch50_cpp_profile <input> [--every N] [--policy walk|Switch|Table|ComputedGoto|HotFirst]
+// walk parses with a handler that has no methods, so nothing is dispatched; the others count
+// messages by type through that dispatch policy.
+
+#include "itch/dispatch.hpp"
+#include "itch/parser.hpp"
+#include "itch/perf/perf.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <string_view>
+
+namespace {
+
+using namespace itch::spec::view;
+
+struct HandlerNone {};
+
+struct HandlerCount {
+	std::array<std::uint64_t, 256> counts{};
+
+	void onSystemEvent(const SystemEventView) noexcept { ++counts['S']; }
+	void onStockDirectory(const StockDirectoryView) noexcept { ++counts['R']; }
+	void onStockTradingAction(const StockTradingActionView) noexcept { ++counts['H']; }
+	void onRegSHORestriction(const RegSHORestrictionView) noexcept { ++counts['Y']; }
+	void onMarketParticipantPosition(const MarketParticipantPositionView) noexcept { ++counts['L']; }
+	void onMWCBDeclineLevel(const MWCBDeclineLevelView) noexcept { ++counts['V']; }
+	void onMWCBStatus(const MWCBStatusView) noexcept { ++counts['W']; }
+	void onIPOQuotingPeriodUpdate(const IPOQuotingPeriodUpdateView) noexcept { ++counts['K']; }
+	void onLULDAuctionCollar(const LULDAuctionCollarView) noexcept { ++counts['J']; }
+	void onOperationalHalt(const OperationalHaltView) noexcept { ++counts['h']; }
+	void onAddOrder(const AddOrderView) noexcept { ++counts['A']; }
+	void onAddOrderWithMPID(const AddOrderWithMPIDView) noexcept { ++counts['F']; }
+	void onExecuteOrder(const ExecuteOrderView) noexcept { ++counts['E']; }
+	void onExecuteOrderWithPrice(const ExecuteOrderWithPriceView) noexcept { ++counts['C']; }
+	void onCancelOrder(const CancelOrderView) noexcept { ++counts['X']; }
+	void onDeleteOrder(const DeleteOrderView) noexcept { ++counts['D']; }
+	void onReplaceOrder(const ReplaceOrderView) noexcept { ++counts['U']; }
+	void onNonCrossTrade(const NonCrossTradeView) noexcept { ++counts['P']; }
+	void onCrossTrade(const CrossTradeView) noexcept { ++counts['Q']; }
+	void onBrokenTrade(const BrokenTradeView) noexcept { ++counts['B']; }
+	void onNetOrderImbalance(const NetOrderImbalanceView) noexcept { ++counts['I']; }
+	void onRetailPriceImprovement(const RetailPriceImprovementView) noexcept { ++counts['N']; }
+	void onDLCRPriceDiscovery(const DLCRPriceDiscoveryView) noexcept { ++counts['O']; }
+};
+
+void usage() {
+	std::fprintf(stderr,
+		"usage: tv_itch50_cpp_profile <input> [--every N]\n"
+		"                             [--policy walk|Switch|Table|ComputedGoto|HotFirst]\n");
+}
+
+template <class Handler, class Policy>
+void run(const std::string& input, const std::uint64_t every) {
+	Handler h;
+	itch::Parser<Handler, Policy> parser(input, h);
+	const itch::perf::Profile profile = itch::perf::profile(parser, every);
+	std::fputs(itch::perf::report(profile).c_str(), stdout);
+
+	if constexpr (requires { h.counts; }) {
+		std::printf("messages by type:");
+		for (std::size_t type = 0; type < h.counts.size(); ++type) {
+			if (h.counts[type] != 0) {
+				std::printf(" %c=%llu", static_cast<char>(type), static_cast<unsigned long long>(h.counts[type]));
+			}
+		}
+		std::printf("\n");
+	}
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	std::string input;
+	std::string_view policy = "Switch";
+	std::uint64_t every = 1'000'000;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string_view arg = argv[i];
+		const char* const value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (arg.starts_with("--") && value == nullptr) {
+			usage();
+			return 2;
+		}
+		if (arg == "--every") {
+			every = std::strtoull(value, nullptr, 10);
+		} else if (arg == "--policy") {
+			policy = value;
+		} else if (!arg.starts_with("--") && input.empty()) {
+			input = arg;
+			continue;
+		} else {
+			usage();
+			return 2;
+		}
+		++i;
+	}
+
+	if (input.empty()) {
+		usage();
+		return 2;
+	}
+
+	try {
+		if (policy == "walk") {
+			run<HandlerNone, itch::policy::Switch>(input, every);
+		} else if (policy == "Switch") {
+			run<HandlerCount, itch::policy::Switch>(input, every);
+		} else if (policy == "Table") {
+			run<HandlerCount, itch::policy::Table>(input, every);
+		} else if (policy == "ComputedGoto") {
+			run<HandlerCount, itch::policy::ComputedGoto>(input, every);
+		} else if (policy == "HotFirst") {
+			run<HandlerCount, itch::policy::HotFirst>(input, every);
+		} else {
+			usage();
+			return 2;
+		}
+	} catch (const std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,138 @@
+// Sends an ITCH file as a MoldUDP64 feed, to drive a receiver end to end. Usage:
+//   tv_itch50_cpp_replay <input> --to ADDRESS:PORT [--interface ADDRESS] [--ttl N]
+//                        [--packet-size N] [--max-messages N] [--max-delay-us N]
+//                        [--pace max|realtime|Nx] [--drop-one-in N] [--session NAME]
+// ADDRESS may be a multicast group, sent from --interface. --pace realtime plays the feed back
+// at its timestamps, 10x ten times faster, max (the default) as fast as the socket takes it.
+// Ctrl-C stops the replay, without the end-of-session packet.
+
+#include "itch/mold/replay.hpp"
+
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <string_view>
+
+namespace {
+
+itch::mold::Replayer* running = nullptr;
+
+extern "C" void interrupt(int) {
+	if (running != nullptr) running->stop();
+}
+
+void usage() {
+	std::fprintf(stderr,
+		"usage: tv_itch50_cpp_replay <input> --to ADDRESS:PORT [--interface ADDRESS] [--ttl N]\n"
+		"                            [--packet-size N] [--max-messages N] [--max-delay-us N]\n"
+		"                            [--pace max|realtime|Nx] [--drop-one-in N] [--session NAME]\n");
+}
+
+// "239.1.1.1:26477" sets the address and the port.
+bool parse_destination(const std::string_view text, itch::mold::SenderOptions& destination) {
+	const auto colon = text.rfind(':');
+	if (colon == std::string_view::npos || colon == 0)
+		return false;
+	const unsigned long port = std::strtoul(std::string(text.substr(colon + 1)).c_str(), nullptr, 10);
+	if (port == 0 || port > UINT16_MAX)
+		return false;
+	destination.address = text.substr(0, colon);
+	destination.port = static_cast<std::uint16_t>(port);
+	return true;
+}
+
+// "max" is 0, "realtime" 1, and "10x" 10.
+bool parse_pace(const std::string_view text, double& speed) {
+	if (text == "max") {
+		speed = 0;
+	} else if (text == "realtime") {
+		speed = 1;
+	} else if (text.size() > 1 && text.back() == 'x') {
+		speed = std::strtod(std::string(text.substr(0, text.size() - 1)).c_str(), nullptr);
+		return speed > 0;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	itch::mold::ReplayOptions options;
+	std::string input;
+	bool has_destination = false;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string_view arg = argv[i];
+		const char* const value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (arg.starts_with("--") && value == nullptr) {
+			usage();
+			return 2;
+		}
+		if (arg == "--to") {
+			if (!parse_destination(value, options.destination)) {
+				usage();
+				return 2;
+			}
+			has_destination = true;
+		} else if (arg == "--interface") {
+			options.destination.interface = value;
+		} else if (arg == "--ttl") {
+			options.destination.ttl = std::atoi(value);
+		} else if (arg == "--packet-size") {
+			options.max_packet_size = std::strtoull(value, nullptr, 10);
+		} else if (arg == "--max-messages") {
+			options.max_messages = static_cast<std::uint16_t>(std::strtoul(value, nullptr, 10));
+		} else if (arg == "--max-delay-us") {
+			options.max_delay_ns = std::strtoull(value, nullptr, 10) * 1000;
+		} else if (arg == "--pace") {
+			if (!parse_pace(value, options.speed)) {
+				usage();
+				return 2;
+			}
+		} else if (arg == "--drop-one-in") {
+			options.drop_one_in = std::strtoull(value, nullptr, 10);
+		} else if (arg == "--session") {
+			options.session = value;
+		} else if (!arg.starts_with("--") && input.empty()) {
+			input = arg;
+			continue;
+		} else {
+			usage();
+			return 2;
+		}
+		++i;
+	}
+
+	if (input.empty() || !has_destination) {
+		usage();
+		return 2;
+	}
+
+	try {
+		itch::mold::Replayer replayer(input, options);
+		running = &replayer;
+		std::signal(SIGINT, interrupt);
+		const itch::mold::ReplayStats stats = replayer.run();
+		std::signal(SIGINT, SIG_DFL);
+		running = nullptr;
+
+		std::printf("%llu messages, %llu packets (%llu dropped), %llu bytes in %.3f s",
+			static_cast<unsigned long long>(stats.messages), static_cast<unsigned long long>(stats.packets),
+			static_cast<unsigned long long>(stats.dropped), static_cast<unsigned long long>(stats.bytes),
+			stats.seconds);
+		if (options.speed > 0) {
+			std::printf(", at worst %.1f us late", static_cast<double>(stats.max_late_ns) / 1000.0);
+		}
+		std::printf("\n");
+	} catch (const std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}